@@ -0,0 +1,35 @@
+/**
+ * Copyright © 2013 Jean-François Hren <jfhren@gmail.com>
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+#ifndef CRC_H
+#define CRC_H
+#include <stdint.h>
+
+/**
+ * Compute the CRC-8 protecting a frame header, the polynomial being
+ * x^8 + x^2 + x + 1 and the CRC starting from 0.
+ *
+ * @param bytes    The bytes to compute the CRC of.
+ * @param nb_bytes The number of bytes.
+ *
+ * @return Return the CRC-8 of the bytes.
+ */
+uint8_t crc8(const uint8_t* bytes, int nb_bytes);
+
+/**
+ * Update a CRC-16 protecting a frame with more bytes, the polynomial being
+ * x^16 + x^15 + x^2 + 1 and the CRC starting from 0.
+ *
+ * @param crc      The CRC-16 of the previous bytes.
+ * @param bytes    The bytes to update the CRC with.
+ * @param nb_bytes The number of bytes.
+ *
+ * @return Return the CRC-16 of the previous bytes followed by the given ones.
+ */
+uint16_t crc16(uint16_t crc, const uint8_t* bytes, int nb_bytes);
+
+#endif
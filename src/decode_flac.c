@@ -5,39 +5,42 @@
  * as published by Sam Hocevar. See the COPYING file for more details.
  */
 
+#define _POSIX_C_SOURCE 200112L
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <limits.h>
+#ifndef DISALLOW_THREADS
+#include <pthread.h>
+#endif
 
 #include "decode_flac.h"
+#include "lpc.h"
+#include "stereo.h"
+#include "pack.h"
+#include "crc.h"
 
 /**
- * A linked list element for saving a previously decode value.
+ * The maximum number of samples in a block.
  */
-typedef struct previous_value {
-    DECODE_TYPE value;
-    struct previous_value* next;
-} previous_value_t ;
+#define MAX_BLOCK_SIZE 65535
 
 /**
- * Represent the current state of rice code decoding.
+ * The type of the seek table metadata block.
  */
-typedef struct {
-    uint8_t rice_parameter_size;    /**< The size of the rice code parameter (4
-                                         or 5 bits). */
-    uint8_t rice_parameter;         /**< The rice code parameter. */
-    uint8_t partition_order;        /**< The partition order of the rice coded
-                                         residuals. */
-    uint8_t is_first_partition;     /**< Is the current partition the first
-                                         one? */
-    uint8_t has_escape_code;        /**< Is the current partition an escaped
-                                         one? */
-    uint8_t escape_bits_per_sample; /**< Number of bits used for each escaped
-                                         residual. */
-    uint16_t remaining_nb_samples;  /**< The remaining number of samples to
-                                         return in the current partition. */
-} rice_coding_info_t;
+#define METADATA_SEEKTABLE 3
+
+/**
+ * The maximum size in bytes of a frame header, its CRC-8 included.
+ */
+#define MAX_FRAME_HEADER_SIZE 16
+
+/**
+ * The zero bytes put after the copied bytes of a frame so that it can be
+ * decoded on its own without refilling.
+ */
+#define FRAME_BYTES_PADDING MAX_FRAME_HEADER_SIZE
 
 /**
  * Represent a subframe currently being decode.
@@ -50,27 +53,11 @@ typedef struct {
                                          taking into account stereo encoding
                                          (but not wasted bits). */
 
-    int data_input_position;    /**< If not -1, the current position in the
-                                     input stream for this subframe. */
-    uint8_t data_input_shift;   /**< The current shift in the input stream for
-                                     this subframe. */
-
-    DECODE_UTYPE value; /**< The value of a constant subframe or a previously
-                             decoded value of a verbatim subframe. */
-
-    previous_value_t previous_values[32];   /**< Linked list of previous values
-                                                 for fixed or lpc subframes. */
-    previous_value_t* next_out;             /**< The next value to be popped out
-                                                 of the linked list. */
-
     uint8_t lpc_precision;  /**< The lpc's precision of a lpc subframe. */
     int8_t lpc_shift;       /**< The lpc's shift of a lpc subframe. */
     int16_t coeffs[32];     /**< The coefficients of a lpc subframe. */
 
-    rice_coding_info_t residual_info;   /**< The current state of decoding the
-                                             residual. */
-
-    uint8_t has_parameters; /**< Has the parameters fully read? */
+    int32_t* samples;       /**< The decoded samples of the subframe. */
 } subframe_info_t;
 
 typedef struct {
@@ -88,8 +75,59 @@ typedef struct {
     #else
     subframe_info_t subframes_info[8];  /**< The subframes of this frame. */
     #endif
+
+#ifdef DECODE_WIDE_SIDE
+    int64_t* side_samples;          /**< Where the 33 bits side channel of a 32
+                                         bits stream is decoded. */
+#endif
+    uint8_t is_decorrelation_fused; /**< Are the stereo encoded frames left
+                                         correlated by the decoding to be
+                                         decorrelated while packed? */
 } frame_info_t;
 
+/**
+ * What is needed from a frame header to find frames without decoding them.
+ */
+typedef struct {
+    uint8_t blocking_strategy;  /**< 0 if the number is the frame one, 1 if it
+                                     is the one of the first sample. */
+    sample_number_t number;     /**< The frame or first sample number. */
+    uint32_t block_size;        /**< The number of samples in the frame. */
+} frame_header_t;
+
+/**
+ * What is needed to go on after damaged frames.
+ */
+typedef struct {
+    sample_number_t next_sample;    /**< The number of the first sample of the
+                                         frame following the last decoded
+                                         one. */
+    int32_t* samples;               /**< The samples output in place of the
+                                         ones of damaged frames, one block of
+                                         the maximum block size per channel.
+                                         NULL if they are not concealed. */
+    uint16_t nb_samples;            /**< The number of samples of the previous
+                                         frame kept in samples to be repeated,
+                                         0 if silence is output. */
+    uint8_t channel_assignement;    /**< The channel assignement of the samples
+                                         which might be left correlated. */
+    uint16_t block_size;            /**< The block size of every frame but the
+                                         last of a fixed blocking strategy
+                                         stream, 0 if unknown. */
+    sample_number_t nb_stream_samples;/**< The number of samples of the
+                                           stream, 0 if unknown. */
+} resync_state_t;
+
+/**
+ * The bytes of a frame copied out of the input.
+ */
+typedef struct {
+    uint8_t* bytes;     /**< The bytes of the frame followed by
+                             FRAME_BYTES_PADDING bytes. */
+    int size;           /**< The number of bytes of the frame. */
+    int capacity;       /**< The size of the allocated bytes. */
+} frame_bytes_t;
+
 
 /**
  * Read some of the flac stream informations from data_input. The read
@@ -171,19 +209,106 @@ static int get_flac_stream_info(data_input_t* data_input, stream_info_t* stream_
 
 
 /**
- * Skip the unnecessary metadata stored in the flac stream.
+ * Compare two seek points by sample number for qsort.
+ *
+ * @param a The first seek point.
+ * @param b The second seek point.
+ *
+ * @return Return a negative value, 0 or a positive value if the first seek
+ *         point is before, at the same sample as or after the second one.
+ */
+static int compare_seek_points(const void* a, const void* b) {
+
+    const seek_point_t* point_a = (const seek_point_t*)a;
+    const seek_point_t* point_b = (const seek_point_t*)b;
+
+    return (point_a->sample_number > point_b->sample_number) - (point_a->sample_number < point_b->sample_number);
+
+}
+
+
+/**
+ * Read the seek points of a seek table metadata block and append them to the
+ * seek table of the stream info. Placeholder points are left out.
+ *
+ * @param data_input  The seek table is read from there. Should be just after
+ *                    the metadata block header.
+ * @param length      The length in bytes of the metadata block.
+ * @param stream_info The seek points are put there.
+ *
+ * @return Return 0 if successful, -1 else.
+ */
+static int read_seek_table(data_input_t* data_input, uint32_t length, stream_info_t* stream_info) {
+
+    uint32_t nb_points = length / 18;
+    seek_point_t* seek_points = (seek_point_t*)realloc(stream_info->seek_points, sizeof(seek_point_t) * (stream_info->nb_seek_points + nb_points + 1));
+
+    if(seek_points == NULL) {
+        perror("An error occured while allocating the seek table");
+        return -1;
+    }
+
+    stream_info->seek_points = seek_points;
+
+    for(; nb_points > 0; --nb_points) {
+        uint8_t* buffer = NULL;
+        uint32_t high_sample_number = 0;
+        uint32_t low_sample_number = 0;
+
+        if(should_refill_input_buffer(data_input, 18))
+            if(refill_input_buffer_at_least(data_input, 18) == -1)
+                return -1;
+
+        buffer = data_input->buffer + data_input->position;
+        data_input->position += 18;
+
+        high_sample_number = ((uint32_t)buffer[0] << 24) | (buffer[1] << 16) | (buffer[2] << 8) | buffer[3];
+        low_sample_number = ((uint32_t)buffer[4] << 24) | (buffer[5] << 16) | (buffer[6] << 8) | buffer[7];
+
+        /* Placeholder points (and, on 32 bits, points out of reach.) */
+#ifndef DISALLOW_64_BITS
+        if((high_sample_number == 0xFFFFFFFF) && (low_sample_number == 0xFFFFFFFF))
+            continue;
+
+        seek_points[stream_info->nb_seek_points].sample_number = ((uint64_t)high_sample_number << 32) | low_sample_number;
+        seek_points[stream_info->nb_seek_points].offset = ((off_t)(((uint32_t)buffer[8] << 24) | (buffer[9] << 16) | (buffer[10] << 8) | buffer[11]) << 32) | (off_t)(((uint32_t)buffer[12] << 24) | (buffer[13] << 16) | (buffer[14] << 8) | buffer[15]);
+#else
+        if(high_sample_number != 0)
+            continue;
+
+        seek_points[stream_info->nb_seek_points].sample_number = low_sample_number;
+        seek_points[stream_info->nb_seek_points].offset = (off_t)(((uint32_t)buffer[12] << 24) | (buffer[13] << 16) | (buffer[14] << 8) | buffer[15]);
+#endif
+        ++stream_info->nb_seek_points;
+    }
+
+    if(skip_nb_bits(data_input, (int)((length % 18) * 8)) == -1)
+        return -1;
+
+    qsort(stream_info->seek_points, stream_info->nb_seek_points, sizeof(seek_point_t), compare_seek_points);
+
+    return 0;
+
+}
+
+
+/**
+ * Skip the unnecessary metadata stored in the flac stream, the seek table being
+ * read.
  *
- * @param input_data The metadata are read from there making the stream go to
- *                   the first frame.
+ * @param input_data  The metadata are read from there making the stream go to
+ *                    the first frame.
+ * @param stream_info The seek table is put there.
  *
  * @return Return 0 if successful, -1 else.
  */
-static int skip_metadata(data_input_t* data_input) {
+static int skip_metadata(data_input_t* data_input, stream_info_t* stream_info) {
 
     uint8_t was_last = 0;
 
     do {
         uint32_t length = 0;
+        uint8_t block_type = 0;
         uint8_t* buffer = NULL;
         int position = 0;
 
@@ -195,13 +320,18 @@ static int skip_metadata(data_input_t* data_input) {
         position = data_input->position;
 
         was_last = buffer[position] >> 7;
+        block_type = buffer[position] & 0x7F;
         position += 1;
 
         length = (buffer[position] << 16) | (buffer[position + 1] << 8) | buffer[position + 2];
         data_input->position = position + 3;
 
-        if(skip_nb_bits(data_input, (int)(length * 8)) == -1)
+        if(block_type == METADATA_SEEKTABLE) {
+            if(read_seek_table(data_input, length, stream_info) == -1)
+                return -1;
+        } else if(skip_nb_bits(data_input, (int)(length * 8)) == -1) {
             return -1;
+        }
     } while(!was_last);
 
     return 0;
@@ -246,6 +376,10 @@ static int read_frame_header(data_input_t* data_input, uint8_t bits_per_sample,
         return -1;
     }
 
+    /* The CRC-16 of the frame starts with its header. */
+    data_input->crc16 = 0;
+    data_input->crc_position = position;
+
     blocking_strategy = buffer[position + 1] & 0x01;
     position +=2;
 
@@ -279,6 +413,10 @@ static int read_frame_header(data_input_t* data_input, uint8_t bits_per_sample,
 
             case 6:
                 frame_info->bits_per_sample = 24;
+                break;
+
+            case 7:
+                frame_info->bits_per_sample = 32;
         }
     }
 
@@ -428,6 +566,12 @@ static int read_frame_header(data_input_t* data_input, uint8_t bits_per_sample,
     else if((sample_rate == 0x0D) || (sample_rate == 0x0E))
         position += 2;
 
+    if((data_input->crc_check != CRC_CHECK_OFF) && (crc8(buffer + data_input->crc_position, position - data_input->crc_position) != buffer[position])) {
+        fprintf(stderr, "The CRC-8 of a frame header does not match\n");
+        if(data_input->crc_check == CRC_CHECK_STRICT)
+            return -1;
+    }
+
     data_input->position = position + 1;
 
     return 1;
@@ -436,1438 +580,1869 @@ static int read_frame_header(data_input_t* data_input, uint8_t bits_per_sample,
 
 
 /**
- * Read a subframe header mainly to get its type and the number of wasted bits
- * per sample if any.
+ * Check that a valid frame header, CRC-8 included, starts at the given bytes
+ * and get what is needed to find the frames following it. Nothing is consumed
+ * from the input.
  *
- * @param data_input    Subframe header informations are read from there.
- * @param subframe_info Subframe header informations are put there.
+ * @param bytes    The bytes the frame header should start at.
+ * @param nb_bytes The number of available bytes.
+ * @param header   The frame header informations are put there.
  *
- * @return Return 0 if successful, -1 else.
+ * @return Return the size in bytes of the frame header if valid, 0 else.
  */
-static int read_subframe_header(data_input_t* data_input, subframe_info_t* subframe_info) {
-
-    int error_code = 0;
-    uint8_t partial_subframe_header_data = get_shifted_bits(data_input, 8, &error_code);
-    if(error_code == -1)
-        return -1;
-
-    subframe_info->type = (partial_subframe_header_data >> 1) & 0x3F;
-    subframe_info->wasted_bits_per_sample = partial_subframe_header_data & 0x01;
-
-    if(subframe_info->wasted_bits_per_sample) {
-        while(get_one_shifted_bit(data_input, &error_code) == 0)
-            ++subframe_info->wasted_bits_per_sample;
-        if(error_code == -1)
-            return -1;
-    }
+static int parse_frame_header(const uint8_t* bytes, int nb_bytes, frame_header_t* header) {
 
-    return 0;
+    uint8_t block_size_code = 0;
+    uint8_t sample_rate_code = 0;
+    uint8_t nb_coding_bytes = 1;
+    int position = 4;
 
-}
+    if((nb_bytes < 6) || (bytes[0] != 0xFF) || ((bytes[1] & 0xFE) != 0xF8))
+        return 0;
 
+    header->blocking_strategy = bytes[1] & 0x01;
+    block_size_code = bytes[2] >> 4;
+    sample_rate_code = bytes[2] & 0x0F;
 
-/**
- * Get the next residual coded using Rice codes from the flac stream and return
- * it. Residuals are coded using two Rice codes kind which differ by their
- * parameter size.
- *
- * @param data_input      Needed data are fetched from there.
- * @param residual_info   Retain the information about the currently decoded
- *                        residuals across calls to this function.
- * @param predictor_order Used to compute the number of partitions and thus the
- *                        number of samples per partition.
- * @param error_code      Like its name indicates, it is used to tell the caller
- *                        if an error occured or not. If equal to -1, yes else
- *                        no.
- *
- * @return Return the decoded residual.
- */
-static DECODE_TYPE get_next_rice_residual(data_input_t* data_input, rice_coding_info_t* residual_info, uint16_t block_size, uint8_t predictor_order, int* error_code) {
+    /* Reserved block size, sample rate, channel assignement, sample size and
+       bit. */
+    if((block_size_code == 0) || (sample_rate_code == 0x0F) || ((bytes[3] >> 4) > MID_SIDE) || (((bytes[3] >> 1) & 0x07) == 3) || (bytes[3] & 0x01))
+        return 0;
 
-    static uint16_t nb_partitions[] = {1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192, 16384, 32768};
-    DECODE_TYPE value = 0;
+    /* The frame or sample number is coded like an UTF-8 character. */
+    if(bytes[position] & 0x80) {
+        while((nb_coding_bytes < 8) && (bytes[position] & (0x80 >> nb_coding_bytes)))
+            ++nb_coding_bytes;
 
-    if(residual_info->remaining_nb_samples == 0) {
-        residual_info->rice_parameter = get_shifted_bits(data_input, residual_info->rice_parameter_size, error_code);
-        if(*error_code == -1)
+        if((nb_coding_bytes == 1) || (nb_coding_bytes == 8) || ((nb_coding_bytes == 7) && !header->blocking_strategy))
             return 0;
-
-        residual_info->has_escape_code = ((residual_info->rice_parameter_size == 4) && (residual_info->rice_parameter == 0x0F)) || ((residual_info->rice_parameter_size == 5) && (residual_info->rice_parameter == 0x1F));
-
-        if(residual_info->has_escape_code) {
-            residual_info->escape_bits_per_sample = get_shifted_bits(data_input, 5, error_code);
-            if(*error_code == -1)
-                return 0;
-        }
-
-        if(residual_info->is_first_partition) {
-            residual_info->is_first_partition = 0;
-            residual_info->remaining_nb_samples = residual_info->partition_order == 0 ? block_size - predictor_order : (block_size / nb_partitions[residual_info->partition_order]) - predictor_order;
-        } else {
-            residual_info->remaining_nb_samples = block_size / nb_partitions[residual_info->partition_order];
-        }
     }
 
-    if(!residual_info->has_escape_code) {
-        DECODE_UTYPE msb = 0;
+    if((position + nb_coding_bytes) > nb_bytes)
+        return 0;
 
-        while(get_one_shifted_bit(data_input, error_code) == 0)
-            ++msb;
-        if(*error_code == -1)
+    header->number = bytes[position] & (0xFFu >> (nb_coding_bytes == 1 ? 1 : nb_coding_bytes + 1));
+    for(++position, --nb_coding_bytes; nb_coding_bytes > 0; ++position, --nb_coding_bytes) {
+        if((bytes[position] & 0xC0) != 0x80)
             return 0;
 
-        if(residual_info->rice_parameter == 0) {
-            if(msb & 0x01)
-                value = -(msb >> 1) - 1;
-            else
-                value = msb >> 1;
-            --residual_info->remaining_nb_samples;
-            return value;
-        } else {
-            DECODE_UTYPE lsb = 0;
+        header->number = (header->number << 6) | (bytes[position] & 0x3F);
+    }
 
-            lsb = get_shifted_bits(data_input, residual_info->rice_parameter, error_code);
-            if(*error_code == -1)
-                return 0;
-            value = (msb << (residual_info->rice_parameter - 1)) | (lsb >> 1);
-            if(lsb & 0x1)
-                value = -(value + 1);
-        }
-        --residual_info->remaining_nb_samples;
-        return value;
+    /* The optional block size and sample rate bytes and the CRC-8 byte. */
+    if((position + (block_size_code == 0x06) + ((block_size_code == 0x07) << 1) + (sample_rate_code == 0x0C) + (((sample_rate_code == 0x0D) || (sample_rate_code == 0x0E)) << 1)) >= nb_bytes)
+        return 0;
+
+    if(block_size_code == 0x06) {
+        header->block_size = bytes[position] + 1;
+        position += 1;
+    } else if(block_size_code == 0x07) {
+        header->block_size = ((bytes[position] << 8) | bytes[position + 1]) + 1;
+        position += 2;
+    } else if(block_size_code == 0x01) {
+        header->block_size = 192;
+    } else if(block_size_code <= 0x05) {
+        header->block_size = 576u << (block_size_code - 2);
     } else {
-        value = convert_to_signed(get_shifted_bits(data_input, residual_info->escape_bits_per_sample, error_code), residual_info->escape_bits_per_sample);
-        if(*error_code == -1)
-            return 0;
-        --residual_info->remaining_nb_samples;
+        header->block_size = 256u << (block_size_code - 8);
     }
 
-    return value;
+    if(sample_rate_code == 0x0C)
+        position += 1;
+    else if((sample_rate_code == 0x0D) || (sample_rate_code == 0x0E))
+        position += 2;
+
+    if(crc8(bytes, position) != bytes[position])
+        return 0;
+
+    return position + 1;
 
 }
 
 
 /**
- * Decode a constant subframe into the data output sink. A constant subframe
- * is a value repeated a number of time equivalent to the associeted number of
- * samples. Usefull for silent in track and enraging ghost tracks leading.
+ * Tell if a frame header is the one of the frame following another.
  *
- * @param data_input  The value is read from there.
- * @param data_output The resulting samples are sent there.
- * @param frame_info  Used to know the number of samples, the current channel
- *                    assignement or the subframe information.
- * @param channel_nb  Indicate which channel in the channel assignement we are
- *                    currently outputing.
- * @param crt_sample  The number of sample already decoded by a call to this
- *                    function for the current subframe (warmup samples
- *                    included).
- * @param error_code  -1 if an error occured, 0 else.
- *
- * @return Return the number of outputed samples for the current subframe.
+ * @param header      The header of a frame.
+ * @param next_header The header which should be the one of the next frame.
+ *
+ * @return Return 1 if next_header follows header, 0 else.
  */
-static uint16_t decode_constant(data_input_t* data_input, data_output_t* data_output, frame_info_t* frame_info, uint8_t channel_nb, uint16_t crt_sample, int* error_code) {
-
-    subframe_info_t* subframe = frame_info->subframes_info + channel_nb;
-
-    if(!subframe->has_parameters) {
-        subframe->value = get_shifted_bits(data_input, subframe->bits_per_sample - subframe->wasted_bits_per_sample, error_code) << subframe->wasted_bits_per_sample;
-        if(*error_code == -1)
-            return 0;
-
-        subframe->has_parameters = 1;
-    }
-
-    for(;crt_sample < frame_info->block_size; ++crt_sample) {
-       *error_code = put_shifted_bits(data_output, subframe->value, subframe->bits_per_sample, frame_info->channel_assignement, channel_nb);
+static int is_next_frame_header(const frame_header_t* header, const frame_header_t* next_header) {
 
-        if(*error_code == -1)
-            return 0;
-
-        if(*error_code == 0) {
-            if(subframe->data_input_position == -1) {
-                subframe->data_input_position = get_position(data_input);
-                subframe->data_input_shift = data_input->shift;
-            }
+    if(header->blocking_strategy != next_header->blocking_strategy)
+        return 0;
 
-            return crt_sample;
-        }
-    }
+    if(header->blocking_strategy)
+        return next_header->number == (header->number + header->block_size);
 
-    return frame_info->block_size;
+    return next_header->number == (header->number + 1);
 
 }
 
 
 /**
- * Decode a verbatim subframe into the data output sink. A verbatim subframe
- * is a sequence of raw samples like white noise and whatever random stuff.
- *
- * @param data_input  Samples are read from there.
- * @param data_output The resulting samples are outputed there.
- * @param frame_info  Provide usefull informations like the number of samples
- *                    and information on the subframe.
- * @param channel_nb  Indicate which channel in the channel assignement we are
- *                    currently outputing.
- * @param crt_sample  The number of sample already decoded by a call to this
- *                    function for the current subframe (warmup samples
- *                    included).
- * @param error_code  -1 if an error occured, 0 else.
- *
- * @return Return the number of outputed samples for the current subframe.
+ * Append bytes to the bytes of a frame, making room for them and the padding.
+ *
+ * @param frame_bytes The bytes of the frame.
+ * @param bytes       The bytes to append.
+ * @param nb_bytes    The number of bytes to append.
+ *
+ * @return Return 0 if successful, -1 else.
  */
-static uint16_t decode_verbatim(data_input_t* data_input, data_output_t* data_output, frame_info_t* frame_info, uint8_t channel_nb, uint16_t crt_sample, int* error_code) {
-
-    subframe_info_t* subframe = frame_info->subframes_info + channel_nb;
+static int append_frame_bytes(frame_bytes_t* frame_bytes, const uint8_t* bytes, int nb_bytes) {
 
-    if(crt_sample != 0) {
-        *error_code = put_shifted_bits(data_output, subframe->value, subframe->bits_per_sample, frame_info->channel_assignement, channel_nb);
-        if(*error_code == -1)
-            return 0;
-        ++crt_sample;
-    }
+    if((frame_bytes->size + nb_bytes + FRAME_BYTES_PADDING) > frame_bytes->capacity) {
+        int capacity = (frame_bytes->size + nb_bytes + FRAME_BYTES_PADDING) * 2;
+        uint8_t* new_bytes = (uint8_t*)realloc(frame_bytes->bytes, capacity);
 
-    for(;crt_sample < frame_info->block_size; ++crt_sample) {
-        DECODE_UTYPE value = get_shifted_bits(data_input, subframe->bits_per_sample - subframe->wasted_bits_per_sample, error_code) << subframe->wasted_bits_per_sample;
-        if(*error_code == -1)
+        if(new_bytes == NULL) {
+            perror("An error occured while allocating the frame bytes");
             return -1;
-
-        *error_code = put_shifted_bits(data_output, value, subframe->bits_per_sample, frame_info->channel_assignement, channel_nb);
-
-        if(*error_code == -1)
-            return 0;
-
-        if(*error_code == 0) {
-            subframe->value = value;
-            subframe->data_input_position = get_position(data_input);
-            subframe->data_input_shift = data_input->shift;
-
-#ifdef STEREO_ONLY
-            if((channel_nb == 0) && (frame_info->subframes_info[0].data_input_position == -1)) {
-#else
-            if(((channel_nb + 1) < frame_info->nb_channels) && (frame_info->subframes_info[channel_nb + 1].data_input_position == -1)) {
-#endif
-                if(skip_nb_bits(data_input, (subframe->bits_per_sample - subframe->wasted_bits_per_sample) * (frame_info->block_size - (crt_sample + 1))) == -1) {
-                    *error_code = -1;
-                    return 0;
-                }
-            }
-
-            return crt_sample;
         }
+
+        frame_bytes->bytes = new_bytes;
+        frame_bytes->capacity = capacity;
     }
 
-    return frame_info->block_size;
+    memcpy(frame_bytes->bytes + frame_bytes->size, bytes, nb_bytes);
+    frame_bytes->size += nb_bytes;
 
-}
+    return 0;
 
+}
 
-#define INIT_ONE_WARMUP(data_input, subframe, index, next_index, error_code) \
-    do { \
-        (subframe)->previous_values[(index)].value = convert_to_signed(get_shifted_bits((data_input), (subframe)->bits_per_sample - (subframe)->wasted_bits_per_sample, (error_code)), (subframe)->bits_per_sample - (subframe)->wasted_bits_per_sample); \
-        (subframe)->previous_values[(index)].next = (subframe)->previous_values + (next_index); \
-    } while(0)
-
-
-#define OUTPUT_ONE_WARMUP(data_output, frame_info, subframe, channel_nb, index, crt_sample, error_code) \
-    do { \
-        if((*(error_code) = put_shifted_bits((data_output), (subframe)->previous_values[(index)].value << (subframe)->wasted_bits_per_sample, (subframe)->bits_per_sample, (frame_info)->channel_assignement, (channel_nb))) != 1) \
-            break; \
-        ++(crt_sample); \
-    } while(0)
-
-#ifdef STEREO_ONLY
-#define SKIP_INPUT(data_input, frame_info, subframe, channel_nb, order,  starting_sample, error_code) \
-    do { \
-        (subframe)->data_input_position = get_position((data_input)); \
-        (subframe)->data_input_shift = (data_input)->shift; \
-        if(((channel_nb) == 0) && ((frame_info)->subframes_info[1].data_input_position == -1)) { \
-            uint16_t crt_skipped_sample = (starting_sample); \
-            rice_coding_info_t residual_info = (subframe)->residual_info; \
-            for(; crt_skipped_sample < frame_info->block_size; ++crt_skipped_sample) \
-                get_next_rice_residual((data_input), &residual_info, (frame_info)->block_size, (order), (error_code)); \
-            if(*(error_code) == -1) \
-                return 0; \
-        } \
-    } while(0)
-#else
-#define SKIP_INPUT(data_input, frame_info, subframe, channel_nb, order,  starting_sample, error_code) \
-    do { \
-        (subframe)->data_input_position = get_position((data_input)); \
-        (subframe)->data_input_shift = (data_input)->shift; \
-        if(((channel_nb + 1) < frame_info->nb_channels) && (frame_info->subframes_info[channel_nb + 1].data_input_position == -1)) { \
-            uint16_t crt_skipped_sample = (starting_sample); \
-            rice_coding_info_t residual_info = (subframe)->residual_info; \
-            for(; crt_skipped_sample < frame_info->block_size; ++crt_skipped_sample) \
-                get_next_rice_residual((data_input), &residual_info, (frame_info)->block_size, (order), (error_code)); \
-            if(*(error_code) == -1) \
-                return 0; \
-        } \
-    } while(0)
-#endif
 
 /**
- * Decode a fixed subframe into the data output sink. In a fixed subframe,
- * samples are encoded using a fixed linear predictor of zero to fourth order.
+ * Go past the next frame without decoding it. The end of the frame is the next
+ * sync code starting a valid frame header whose frame or sample number follows
+ * the one of the frame. The last frame ends with the input. The sync codes are
+ * looked for with memchr which is vectorised by the C library.
  *
- * @param data_input  Warm-up samples and residuals are read from there.
- * @param data_output The decoded samples are outputed there.
- * @param frame_info  Provide usefull information like the number of samples and
- *                    information on the subframe.
- * @param channel_nb  Indicate which channel in the channel assignement we are
- *                    currently outputing.
- * @param crt_sample  The number of sample already decoded by a call to this
- *                    function for the current subframe (warmup samples
- *                    included).
- * @param error_code  -1 if an error occured, 0 else.
- *
- * @return Return the number of outputed samples for the current subframe.
+ * @param data_input  The frame is read from there.
+ * @param header      The header of the frame is put there.
+ * @param frame_bytes If not NULL, the bytes of the frame are copied there.
+ *
+ * @return Return 1 if successful, 0 if there is no frame left or -1 in case of
+ *         an unexpected error.
  */
-static uint16_t decode_fixed(data_input_t* data_input, data_output_t* data_output, frame_info_t* frame_info, uint8_t channel_nb, uint16_t crt_sample, int* error_code) {
-
-    subframe_info_t* subframe = frame_info->subframes_info + channel_nb;
-    uint8_t order = subframe->type - 8;
-
-    if(!subframe->has_parameters) {
-        uint8_t residual_coding_method = 0;
-
-        if(order) {
-            switch(order) {
-                case 4:
-                    INIT_ONE_WARMUP(data_input, subframe, 0, 1, error_code);
-                    /* FALLTHROUGH */
+static int read_frame_bytes(data_input_t* data_input, frame_header_t* header, frame_bytes_t* frame_bytes) {
 
-                case 3:
-                    INIT_ONE_WARMUP(data_input, subframe, order - 3, order - 2, error_code);
-                    /* FALLTHROUGH */
+    frame_header_t next_header;
+    int is_at_end = data_input->is_mapped;
+    int scan_position = 0;
 
-                case 2:
-                    INIT_ONE_WARMUP(data_input, subframe, order - 2, order - 1, error_code);
-                    /* FALLTHROUGH */
+    if(frame_bytes != NULL)
+        frame_bytes->size = 0;
 
-                case 1:
-                    INIT_ONE_WARMUP(data_input, subframe, order - 1, order, error_code);
-            }
+    if(should_refill_input_buffer(data_input, MAX_FRAME_HEADER_SIZE)) {
+        int error_code = refill_input_buffer(data_input);
+        if(error_code == -1)
+            return -1;
+        if(error_code == 0)
+            is_at_end = 1;
+    }
 
-            if(*error_code == -1)
-                return 0;
+    scan_position = parse_frame_header(data_input->buffer + data_input->position, data_input->read_size - data_input->position, header);
+    if(scan_position == 0) {
+        /* Like the sequential decoding, a few bytes left are not a frame. */
+        if((data_input->read_size - data_input->position) < MAX_FRAME_HEADER_SIZE)
+            return 0;
 
-            if(order > 1)
-                subframe->previous_values[order - 1].next = subframe->previous_values;
-        }
+        fprintf(stderr, "Something is wrong with the synchro.\n");
+        return -1;
+    }
 
-        subframe->next_out = subframe->previous_values;
+    scan_position += data_input->position;
 
-        residual_coding_method = get_shifted_bits(data_input, 2, error_code);
-        if(*error_code == -1)
-            return 0;
+    for(;;) {
+        /* A candidate needs a whole header after it unless the input ends. */
+        int scan_end = is_at_end ? data_input->read_size : data_input->read_size - MAX_FRAME_HEADER_SIZE + 1;
 
-        switch(residual_coding_method) {
-            case 0:
-                subframe->residual_info.rice_parameter_size = 4;
-                break;
+        while(scan_position < scan_end) {
+            const uint8_t* candidate = memchr(data_input->buffer + scan_position, 0xFF, scan_end - scan_position);
 
-            case 1:
-                subframe->residual_info.rice_parameter_size = 5;
+            if(candidate == NULL)
                 break;
 
-            default:
-                fprintf(stderr, "Invalid residual encoding method\n");
-                *error_code = -1;
-                return 0;
-        }
+            scan_position = candidate - data_input->buffer;
+            if(parse_frame_header(candidate, data_input->read_size - scan_position, &next_header) && is_next_frame_header(header, &next_header)) {
+                if((frame_bytes != NULL) && (append_frame_bytes(frame_bytes, data_input->buffer + data_input->position, scan_position - data_input->position) == -1))
+                    return -1;
 
-        subframe->residual_info.rice_parameter = 0;
-        subframe->residual_info.has_escape_code = 0;
-        subframe->residual_info.escape_bits_per_sample = 0;
-        subframe->residual_info.remaining_nb_samples = 0;
-        subframe->residual_info.is_first_partition = 1;
+                data_input->position = scan_position;
+                return 1;
+            }
 
-        subframe->residual_info.partition_order = get_shifted_bits(data_input, 4, error_code);
-        if(*error_code == -1)
-            return 0;
+            ++scan_position;
+        }
 
-        subframe->has_parameters = 1;
+        if(scan_end > data_input->position) {
+            if((frame_bytes != NULL) && (append_frame_bytes(frame_bytes, data_input->buffer + data_input->position, scan_end - data_input->position) == -1))
+                return -1;
 
-        if(!order) {
-            subframe->previous_values[0].value = get_next_rice_residual(data_input, &(subframe->residual_info), frame_info->block_size, order, error_code);
-            if(*error_code == -1)
-                return 0;
+            data_input->position = scan_end;
         }
-    }
-
-    if(crt_sample < order) {
-        switch(order - crt_sample) {
-            case 4:
-                OUTPUT_ONE_WARMUP(data_output, frame_info, subframe, channel_nb, 0, crt_sample, error_code);
-                /* FALLTHROUGH */
 
-            case 3:
-                OUTPUT_ONE_WARMUP(data_output, frame_info, subframe, channel_nb, crt_sample, crt_sample, error_code);
-                /* FALLTHROUGH */
+        if(is_at_end)
+            return 1;
 
-            case 2:
-                OUTPUT_ONE_WARMUP(data_output, frame_info, subframe, channel_nb, crt_sample, crt_sample, error_code);
-                /* FALLTHROUGH */
+        switch(refill_input_buffer(data_input)) {
+            case -1:
+                return -1;
 
-            case 1:
-                OUTPUT_ONE_WARMUP(data_output, frame_info, subframe, channel_nb, crt_sample, crt_sample, error_code);
-                goto decode_fixed_subframe;
+            case 0:
+                is_at_end = 1;
         }
 
-        if(*error_code == -1)
-            return 0;
-
-        SKIP_INPUT(data_input, frame_info, subframe, channel_nb, order, order, error_code);
-        return crt_sample;
-    } else {
-        *error_code = put_shifted_bits(data_output, subframe->next_out->value << subframe->wasted_bits_per_sample, subframe->bits_per_sample, frame_info->channel_assignement, channel_nb);
-        if(*error_code == -1)
-            return 0;
-
-        ++crt_sample;
-        if(order > 1)
-            subframe->next_out = subframe->next_out->next;
+        scan_position = data_input->position;
     }
 
-decode_fixed_subframe:;
-    switch(order) {
-        case 0:
-            for(;crt_sample < frame_info->block_size; ++crt_sample) {
-                DECODE_TYPE value = get_next_rice_residual(data_input, &(subframe->residual_info), frame_info->block_size, 0, error_code);
-                if(*error_code == -1)
-                    return 0;
-
-                *error_code = put_shifted_bits(data_output, value << subframe->wasted_bits_per_sample, subframe->bits_per_sample, frame_info->channel_assignement, channel_nb);
-                if(*error_code == -1)
-                    return 0;
-
-                if(*error_code == 0) {
-                    subframe->previous_values[0].value = value;
-                    goto buffer_full_error;
-                }
-            }
-
-            return frame_info->block_size;
-
-#define OUTPUT_VALUE(data_output, frame_info, subframe, channel_nb, value, error_code) \
-    do { \
-        *(error_code) = put_shifted_bits((data_output), (value) << (subframe)->wasted_bits_per_sample, (subframe)->bits_per_sample, (frame_info)->channel_assignement, (channel_nb)); \
-        if(*(error_code) == -1) \
-            return 0; \
-        if(*(error_code) == 0) \
-            goto buffer_full_error; \
-    } while(0)
+}
 
-        case 1:
-            for(;crt_sample < frame_info->block_size; ++crt_sample) {
-                DECODE_TYPE value = subframe->previous_values[0].value + get_next_rice_residual(data_input, &(subframe->residual_info), frame_info->block_size, 1, error_code);
-                subframe->previous_values[0].value = value;
 
-                if(*error_code == -1)
-                    return 0;
+/**
+ * Get the number of the first sample of a frame from its header. With a fixed
+ * blocking strategy, every frame but the last has the same block size, the one
+ * of the stream since the last frame may be shorter.
+ *
+ * @param header     The header of the frame.
+ * @param block_size The block size of the fixed blocking strategy stream, 0 if
+ *                   unknown to fall back on the one of the frame.
+ *
+ * @return Return the number of the first sample.
+ */
+static sample_number_t get_first_sample(const frame_header_t* header, uint16_t block_size) {
 
-                OUTPUT_VALUE(data_output, frame_info, subframe, channel_nb, value, error_code);
-            }
+    if(header->blocking_strategy)
+        return header->number;
 
-            return frame_info->block_size;
+    return header->number * (block_size ? block_size : header->block_size);
 
-        case 2:
-            for(;crt_sample < frame_info->block_size; ++crt_sample) {
-                DECODE_TYPE value = (subframe->next_out->next->value << 1) - subframe->next_out->value + get_next_rice_residual(data_input, &(subframe->residual_info), frame_info->block_size, 2, error_code);
-                subframe->next_out->value = value;
+}
 
-                if(*error_code == -1)
-                    return 0;
 
-                OUTPUT_VALUE(data_output, frame_info, subframe, channel_nb, value, error_code);
+/**
+ * Go to the first valid frame header, CRC-8 included, from a position in the
+ * input. The sync codes are looked for with memchr like read_frame_bytes does.
+ *
+ * @param data_input The stream is read from there and put at the found frame
+ *                   header.
+ * @param position   The position in the stream to look from.
+ * @param header     The found frame header informations are put there.
+ *
+ * @return Return 1 if a frame header is found, 0 if the input ends before any
+ *         or -1 in case of an unexpected error.
+ */
+static int find_frame_header(data_input_t* data_input, off_t position, frame_header_t* header) {
 
-                subframe->next_out = subframe->next_out->next;
-            }
+    int is_at_end = data_input->is_mapped;
 
-            return frame_info->block_size;
+    if(skip_to_position(data_input, position) == -1)
+        return -1;
 
-        case 3:
-            for(;crt_sample < frame_info->block_size; ++crt_sample) {
-                DECODE_TYPE value = ((subframe->next_out->next->next->value << 1) + subframe->next_out->next->next->value) - ((subframe->next_out->next->value << 1) + subframe->next_out->next->value) + subframe->next_out->value + get_next_rice_residual(data_input, &(subframe->residual_info), frame_info->block_size, 3, error_code);
-                subframe->next_out->value = value;
+    /* What was left of the damaged frame is not part of any CRC. */
+    data_input->shift = 0;
+    data_input->crc_position = data_input->position;
 
-                if(*error_code == -1)
-                    return 0;
+    for(;;) {
+        /* A candidate needs a whole header after it unless the input ends. */
+        int scan_end = is_at_end ? data_input->read_size : data_input->read_size - MAX_FRAME_HEADER_SIZE + 1;
 
-                OUTPUT_VALUE(data_output, frame_info, subframe, channel_nb, value, error_code);
+        while(data_input->position < scan_end) {
+            const uint8_t* candidate = memchr(data_input->buffer + data_input->position, 0xFF, scan_end - data_input->position);
 
-                subframe->next_out = subframe->next_out->next;
+            if(candidate == NULL) {
+                data_input->position = scan_end;
+                break;
             }
 
-            return frame_info->block_size;
-
-        case 4:
-            for(;crt_sample < frame_info->block_size; ++crt_sample) {
-                DECODE_TYPE value = (subframe->next_out->next->next->next->value << 2) - (((subframe->next_out->next->next->value << 1) + subframe->next_out->next->next->value) << 1) + (subframe->next_out->next->value << 2) - subframe->next_out->value + get_next_rice_residual(data_input, &(subframe->residual_info), frame_info->block_size, 4, error_code);
-                subframe->next_out->value = value;
+            data_input->position = candidate - data_input->buffer;
+            if(parse_frame_header(candidate, data_input->read_size - data_input->position, header))
+                return 1;
 
-                if(*error_code == -1)
-                    return 0;
-
-                OUTPUT_VALUE(data_output, frame_info, subframe, channel_nb, value, error_code);
-
-                subframe->next_out = subframe->next_out->next;
-            }
+            ++data_input->position;
+        }
 
-            return frame_info->block_size;
+        if(is_at_end)
+            return 0;
 
-#undef OUTPUT_VALUE
+        data_input->crc_position = data_input->position;
+        switch(refill_input_buffer(data_input)) {
+            case -1:
+                return -1;
 
+            case 0:
+                is_at_end = 1;
+        }
     }
 
-
-buffer_full_error:;
-    SKIP_INPUT(data_input, frame_info, subframe, channel_nb, order, crt_sample + 1, error_code);
-    return crt_sample;
-
 }
 
 
 /**
- * Decode a LPC subframe into the data output sink. In a LPC subframe, samples
- * are encoded using FIR linear prediction of one to thirty-second order.
+ * Read a subframe header mainly to get its type and the number of wasted bits
+ * per sample if any.
  *
- * @param data_input  Parameters, warm-up samples and residuals are read from
- *                    there.
- * @param data_output The decoded samples are outputed there.
- * @param frame_info  Provide usefull informations like the number of samples
- *                    and information on the subframe.
- * @param channel_nb  Indicate which channel in the channel assignement we are
- *                    currently outputing.
- * @param crt_sample  The number of sample already decoded by a call to this
- *                    function for the current subframe (warmup samples
- *                    included).
- * @param error_code  -1 if an error occured, 0 else.
- *
- * @return Return the number of outputed samples for the current subframe.
+ * @param data_input    Subframe header informations are read from there.
+ * @param subframe_info Subframe header informations are put there.
+ *
+ * @return Return 0 if successful, -1 else.
  */
-static uint16_t decode_lpc(data_input_t* data_input, data_output_t* data_output, frame_info_t* frame_info, uint8_t channel_nb, uint16_t crt_sample, int* error_code) {
+static int read_subframe_header(data_input_t* data_input, subframe_info_t* subframe_info) {
 
-    subframe_info_t* subframe = frame_info->subframes_info + channel_nb;
-    uint8_t order = (subframe->type & 0x1F) + 1;
-    static uint32_t dividers[] = {1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192, 16384, 32768, 65536};
-
-    if(!subframe->has_parameters) {
-        uint8_t i = 0;
-        uint8_t residual_coding_method = 0;
-
-        switch(order) {
-            case 32:
-                INIT_ONE_WARMUP(data_input, subframe, i, i + 1, error_code);
-                ++i;
-                /* FALLTHROUGH */
-
-            case 31:
-                INIT_ONE_WARMUP(data_input, subframe, i, i + 1, error_code);
-                ++i;
-                /* FALLTHROUGH */
-
-            case 30:
-                INIT_ONE_WARMUP(data_input, subframe, i, i + 1, error_code);
-                ++i;
-                /* FALLTHROUGH */
-
-            case 29:
-                INIT_ONE_WARMUP(data_input, subframe, i, i + 1, error_code);
-                ++i;
-                /* FALLTHROUGH */
-
-            case 28:
-                INIT_ONE_WARMUP(data_input, subframe, i, i + 1, error_code);
-                ++i;
-                /* FALLTHROUGH */
-
-            case 27:
-                INIT_ONE_WARMUP(data_input, subframe, i, i + 1, error_code);
-                ++i;
-                /* FALLTHROUGH */
-
-            case 26:
-                INIT_ONE_WARMUP(data_input, subframe, i, i + 1, error_code);
-                ++i;
-                /* FALLTHROUGH */
-
-            case 25:
-                INIT_ONE_WARMUP(data_input, subframe, i, i + 1, error_code);
-                ++i;
-                /* FALLTHROUGH */
-
-            case 24:
-                INIT_ONE_WARMUP(data_input, subframe, i, i + 1, error_code);
-                ++i;
-                /* FALLTHROUGH */
-
-            case 23:
-                INIT_ONE_WARMUP(data_input, subframe, i, i + 1, error_code);
-                ++i;
-                /* FALLTHROUGH */
-
-            case 22:
-                INIT_ONE_WARMUP(data_input, subframe, i, i + 1, error_code);
-                ++i;
-                /* FALLTHROUGH */
-
-            case 21:
-                INIT_ONE_WARMUP(data_input, subframe, i, i + 1, error_code);
-                ++i;
-                /* FALLTHROUGH */
-
-            case 20:
-                INIT_ONE_WARMUP(data_input, subframe, i, i + 1, error_code);
-                ++i;
-                /* FALLTHROUGH */
-
-            case 19:
-                INIT_ONE_WARMUP(data_input, subframe, i, i + 1, error_code);
-                ++i;
-                /* FALLTHROUGH */
-
-            case 18:
-                INIT_ONE_WARMUP(data_input, subframe, i, i + 1, error_code);
-                ++i;
-                /* FALLTHROUGH */
-
-            case 17:
-                INIT_ONE_WARMUP(data_input, subframe, i, i + 1, error_code);
-                ++i;
-                /* FALLTHROUGH */
-
-            case 16:
-                INIT_ONE_WARMUP(data_input, subframe, i, i + 1, error_code);
-                ++i;
-                /* FALLTHROUGH */
+    int error_code = 0;
+    uint8_t partial_subframe_header_data = get_shifted_bits(data_input, 8, &error_code);
+    if(error_code == -1)
+        return -1;
 
-            case 15:
-                INIT_ONE_WARMUP(data_input, subframe, i, i + 1, error_code);
-                ++i;
-                /* FALLTHROUGH */
+    subframe_info->type = (partial_subframe_header_data >> 1) & 0x3F;
+    subframe_info->wasted_bits_per_sample = partial_subframe_header_data & 0x01;
 
-            case 14:
-                INIT_ONE_WARMUP(data_input, subframe, i, i + 1, error_code);
-                ++i;
-                /* FALLTHROUGH */
+    if(subframe_info->wasted_bits_per_sample) {
+        subframe_info->wasted_bits_per_sample += get_unary_value(data_input, &error_code);
+        if(error_code == -1)
+            return -1;
+    }
 
-            case 13:
-                INIT_ONE_WARMUP(data_input, subframe, i, i + 1, error_code);
-                ++i;
-                /* FALLTHROUGH */
+    return 0;
 
-            case 12:
-                INIT_ONE_WARMUP(data_input, subframe, i, i + 1, error_code);
-                ++i;
-                /* FALLTHROUGH */
+}
 
-            case 11:
-                INIT_ONE_WARMUP(data_input, subframe, i, i + 1, error_code);
-                ++i;
-                /* FALLTHROUGH */
 
-            case 10:
-                INIT_ONE_WARMUP(data_input, subframe, i, i + 1, error_code);
-                ++i;
-                /* FALLTHROUGH */
+/**
+ * Decode all the residuals of a subframe coded using Rice codes from the flac
+ * stream. Residuals are coded using two Rice codes kind which differ by their
+ * parameter size and are split in partitions each having its own parameter.
+ * Each partition is decoded in one go.
+ *
+ * @param data_input      Needed data are fetched from there.
+ * @param block_size      The number of samples in the subframe.
+ * @param predictor_order Used to compute the number of samples of the first
+ *                        partition.
+ * @param residuals       The decoded residuals are put there, the first one
+ *                        being the residual of the sample predictor_order.
+ *
+ * @return Return 0 if successful, -1 else.
+ */
+static int decode_residuals(data_input_t* data_input, uint16_t block_size, uint8_t predictor_order, int32_t* residuals) {
 
-            case 9:
-                INIT_ONE_WARMUP(data_input, subframe, i, i + 1, error_code);
-                ++i;
-                /* FALLTHROUGH */
+    int error_code = 0;
+    uint8_t rice_parameter_size = 0;
+    uint8_t escape_code = 0;
+    uint8_t partition_order = 0;
+    uint32_t nb_partitions = 0;
+    uint32_t partition_nb = 0;
 
-            case 8:
-                INIT_ONE_WARMUP(data_input, subframe, i, i + 1, error_code);
-                ++i;
-                /* FALLTHROUGH */
+    switch(get_shifted_bits(data_input, 2, &error_code)) {
+        case 0:
+            rice_parameter_size = 4;
+            escape_code = 0x0F;
+            break;
 
-            case 7:
-                INIT_ONE_WARMUP(data_input, subframe, i, i + 1, error_code);
-                ++i;
-                /* FALLTHROUGH */
+        case 1:
+            rice_parameter_size = 5;
+            escape_code = 0x1F;
+            break;
 
-            case 6:
-                INIT_ONE_WARMUP(data_input, subframe, i, i + 1, error_code);
-                ++i;
-                /* FALLTHROUGH */
+        default:
+            if(error_code != -1)
+                fprintf(stderr, "Invalid residual encoding method\n");
+            return -1;
+    }
 
-            case 5:
-                INIT_ONE_WARMUP(data_input, subframe, i, i + 1, error_code);
-                ++i;
-                /* FALLTHROUGH */
+    partition_order = get_shifted_bits(data_input, 4, &error_code);
+    if(error_code == -1)
+        return -1;
 
-            case 4:
-                INIT_ONE_WARMUP(data_input, subframe, i, i + 1, error_code);
-                ++i;
-                /* FALLTHROUGH */
+    nb_partitions = 1u << partition_order;
+    if((((block_size >> partition_order) << partition_order) != block_size) || ((block_size >> partition_order) < predictor_order)) {
+        fprintf(stderr, "Invalid partition order\n");
+        return -1;
+    }
 
-            case 3:
-                INIT_ONE_WARMUP(data_input, subframe, i, i + 1, error_code);
-                ++i;
-                /* FALLTHROUGH */
+    for(; partition_nb < nb_partitions; ++partition_nb) {
+        uint8_t rice_parameter = get_shifted_bits(data_input, rice_parameter_size, &error_code);
+        uint16_t nb_samples = (block_size >> partition_order) - (partition_nb == 0 ? predictor_order : 0);
+        int32_t* last_residual = residuals + nb_samples;
 
-            case 2:
-                INIT_ONE_WARMUP(data_input, subframe, i, i + 1, error_code);
-                ++i;
-                /* FALLTHROUGH */
+        if(error_code == -1)
+            return -1;
 
-            case 1:
-                INIT_ONE_WARMUP(data_input, subframe, i, i + 1, error_code);
+        if(rice_parameter == escape_code) {
+            uint8_t escape_bits_per_sample = get_shifted_bits(data_input, 5, &error_code);
+            if(error_code == -1)
+                return -1;
+
+            if(escape_bits_per_sample == 0) {
+                memset(residuals, 0, sizeof(int32_t) * nb_samples);
+                residuals = last_residual;
+                continue;
+            }
+
+            for(; residuals < last_residual; ++residuals) {
+                *residuals = convert_to_signed(get_shifted_bits(data_input, escape_bits_per_sample, &error_code), escape_bits_per_sample);
+                if(error_code == -1)
+                    return -1;
+            }
+        } else {
+            if(get_rice_values(data_input, rice_parameter, residuals, nb_samples) == -1)
+                return -1;
+
+            residuals = last_residual;
         }
+    }
+
+    return 0;
+
+}
+
+
+/**
+ * Decode a constant subframe into its sample buffer. A constant subframe is a
+ * value repeated a number of time equivalent to the associeted number of
+ * samples. Usefull for silent in track and enraging ghost tracks leading.
+ *
+ * @param data_input The value is read from there.
+ * @param subframe   The subframe whose sample buffer is filled.
+ * @param block_size The number of samples of the subframe.
+ *
+ * @return Return 0 if successful, -1 else.
+ */
+static int decode_constant(data_input_t* data_input, subframe_info_t* subframe, uint16_t block_size) {
+
+    int error_code = 0;
+    uint8_t nb_bits = subframe->bits_per_sample - subframe->wasted_bits_per_sample;
+    int32_t value = convert_to_signed(get_shifted_bits(data_input, nb_bits, &error_code), nb_bits);
+    int32_t* sample = subframe->samples;
+    int32_t* last_sample = subframe->samples + block_size;
+
+    if(error_code == -1)
+        return -1;
+
+    for(; sample < last_sample; ++sample)
+        *sample = value;
+
+    return 0;
+
+}
+
+
+/**
+ * Decode a verbatim subframe into its sample buffer. A verbatim subframe is a
+ * sequence of raw samples like white noise and whatever random stuff.
+ *
+ * @param data_input Samples are read from there.
+ * @param subframe   The subframe whose sample buffer is filled.
+ * @param block_size The number of samples of the subframe.
+ *
+ * @return Return 0 if successful, -1 else.
+ */
+static int decode_verbatim(data_input_t* data_input, subframe_info_t* subframe, uint16_t block_size) {
+
+    int error_code = 0;
+    uint8_t nb_bits = subframe->bits_per_sample - subframe->wasted_bits_per_sample;
+    int32_t* sample = subframe->samples;
+    int32_t* last_sample = subframe->samples + block_size;
+
+    for(; sample < last_sample; ++sample) {
+        *sample = convert_to_signed(get_shifted_bits(data_input, nb_bits, &error_code), nb_bits);
+        if(error_code == -1)
+            return -1;
+    }
+
+    return 0;
+
+}
+
+
+/**
+ * Read the warm-up samples of a fixed or lpc subframe at the beginning of its
+ * sample buffer.
+ *
+ * @param data_input The warm-up samples are read from there.
+ * @param subframe   The subframe whose sample buffer is filled.
+ * @param order      The predictor order that is the number of warm-up samples.
+ *
+ * @return Return 0 if successful, -1 else.
+ */
+static int read_warmup_samples(data_input_t* data_input, subframe_info_t* subframe, uint8_t order) {
+
+    int error_code = 0;
+    uint8_t nb_bits = subframe->bits_per_sample - subframe->wasted_bits_per_sample;
+    uint8_t i = 0;
+
+    for(; i < order; ++i) {
+        subframe->samples[i] = convert_to_signed(get_shifted_bits(data_input, nb_bits, &error_code), nb_bits);
+        if(error_code == -1)
+            return -1;
+    }
+
+    return 0;
+
+}
+
+
+/**
+ * Decode a fixed subframe into its sample buffer. In a fixed subframe, samples
+ * are encoded using a fixed linear predictor of zero to fourth order.
+ *
+ * @param data_input Warm-up samples and residuals are read from there.
+ * @param subframe   The subframe whose sample buffer is filled.
+ * @param block_size The number of samples of the subframe.
+ *
+ * @return Return 0 if successful, -1 else.
+ */
+static int decode_fixed(data_input_t* data_input, subframe_info_t* subframe, uint16_t block_size) {
+
+    uint8_t order = subframe->type - 8;
+
+    if(order > block_size) {
+        fprintf(stderr, "Invalid predictor order\n");
+        return -1;
+    }
+
+    if(read_warmup_samples(data_input, subframe, order) == -1)
+        return -1;
+
+    /* The residuals are decoded in place and the prediction added to them. */
+    if(decode_residuals(data_input, block_size, order, subframe->samples + order) == -1)
+        return -1;
+
+    get_fixed_restore_func(order, subframe->bits_per_sample - subframe->wasted_bits_per_sample)(subframe->samples + order, subframe->samples + block_size);
+
+    return 0;
+
+}
+
+
+/**
+ * Read the precision, the shift and the coefficients of a lpc subframe which
+ * follow its warm-up samples.
+ *
+ * @param data_input The parameters are read from there.
+ * @param subframe   The subframe whose parameters are filled.
+ * @param order      The lpc order that is the number of coefficients.
+ *
+ * @return Return 0 if successful, -1 else.
+ */
+static int read_lpc_parameters(data_input_t* data_input, subframe_info_t* subframe, uint8_t order) {
+
+    int error_code = 0;
+    uint8_t i = 0;
+
+    subframe->lpc_precision = get_shifted_bits(data_input, 4, &error_code) + 1;
+    if(error_code == -1)
+        return -1;
+
+    subframe->lpc_shift = convert_to_signed(get_shifted_bits(data_input, 5, &error_code), 5);
+    if(error_code == -1)
+        return -1;
+
+    for(; i < order; ++i) {
+        subframe->coeffs[i] = convert_to_signed(get_shifted_bits(data_input, subframe->lpc_precision, &error_code), subframe->lpc_precision);
+        if(error_code == -1)
+            return -1;
+    }
+
+    return 0;
+
+}
+
+
+/**
+ * Decode a LPC subframe into its sample buffer. In a LPC subframe, samples are
+ * encoded using FIR linear prediction of one to thirty-second order.
+ *
+ * @param data_input Parameters, warm-up samples and residuals are read from
+ *                   there.
+ * @param subframe   The subframe whose sample buffer is filled.
+ * @param block_size The number of samples of the subframe.
+ *
+ * @return Return 0 if successful, -1 else.
+ */
+static int decode_lpc(data_input_t* data_input, subframe_info_t* subframe, uint16_t block_size) {
+
+    uint8_t order = (subframe->type & 0x1F) + 1;
+
+    if(order > block_size) {
+        fprintf(stderr, "Invalid predictor order\n");
+        return -1;
+    }
+
+    if(read_warmup_samples(data_input, subframe, order) == -1)
+        return -1;
+
+    if(read_lpc_parameters(data_input, subframe, order) == -1)
+        return -1;
+
+    /* The residuals are decoded in place and the prediction added to them. */
+    if(decode_residuals(data_input, block_size, order, subframe->samples + order) == -1)
+        return -1;
+
+    get_lpc_restore_func(subframe->coeffs, order, subframe->lpc_shift, subframe->bits_per_sample - subframe->wasted_bits_per_sample)(subframe->samples + order, subframe->samples + block_size, subframe->coeffs, order, subframe->lpc_shift);
+
+    return 0;
+
+}
+
+#ifdef DECODE_WIDE_SIDE
+
+/**
+ * Decode the 33 bits side channel of a 32 bits stream into a 64 bits sample
+ * buffer, wasted bits included. The samples of a verbatim subframe are read as
+ * warm-up samples and the residuals of a fixed or lpc subframe are decoded into
+ * the 32 bits sample buffer of the subframe before being restored.
+ *
+ * @param data_input   The subframe is read from there, its header excepted.
+ * @param subframe     The subframe being decoded.
+ * @param side_samples Where the samples are decoded.
+ * @param block_size   The number of samples of the subframe.
+ *
+ * @return Return 0 if successful, -1 else.
+ */
+static int decode_wide_subframe(data_input_t* data_input, subframe_info_t* subframe, int64_t* side_samples, uint16_t block_size) {
+
+    int error_code = 0;
+    uint8_t nb_bits = subframe->bits_per_sample - subframe->wasted_bits_per_sample;
+    uint16_t order = 0;
+    uint16_t i = 0;
+
+    if(subframe->type == SUBFRAME_CONSTANT)
+        order = 1;
+    else if(subframe->type == SUBFRAME_VERBATIM)
+        order = block_size;
+    else if((SUBFRAME_FIXED_LOW <= subframe->type) && (subframe->type <= SUBFRAME_FIXED_HIGH))
+        order = subframe->type - 8;
+    else if((SUBFRAME_LPC_LOW <= subframe->type) && (subframe->type <= SUBFRAME_LPC_HIGH))
+        order = (subframe->type & 0x1F) + 1;
+    else {
+        fprintf(stderr, "Invalid subframe type\n");
+        return -1;
+    }
+
+    if(order > block_size) {
+        fprintf(stderr, "Invalid predictor order\n");
+        return -1;
+    }
+
+    for(; i < order; ++i) {
+        side_samples[i] = convert_to_signed_wide(get_shifted_bits(data_input, nb_bits, &error_code), nb_bits);
+        if(error_code == -1)
+            return -1;
+    }
+
+    if(subframe->type == SUBFRAME_CONSTANT) {
+        for(; i < block_size; ++i)
+            side_samples[i] = side_samples[0];
+    } else if(subframe->type >= SUBFRAME_LPC_LOW) {
+        if(read_lpc_parameters(data_input, subframe, order) == -1)
+            return -1;
+
+        if(decode_residuals(data_input, block_size, order, subframe->samples + order) == -1)
+            return -1;
+
+        restore_lpc_wide(side_samples + order, side_samples + block_size, subframe->samples + order, subframe->coeffs, order, subframe->lpc_shift);
+    } else if(subframe->type >= SUBFRAME_FIXED_LOW) {
+        if(decode_residuals(data_input, block_size, order, subframe->samples + order) == -1)
+            return -1;
+
+        restore_fixed_wide(side_samples + order, side_samples + block_size, subframe->samples + order, order);
+    }
+
+    if(subframe->wasted_bits_per_sample)
+        for(i = 0; i < block_size; ++i)
+            side_samples[i] = (int64_t)((uint64_t)side_samples[i] << subframe->wasted_bits_per_sample);
+
+    return 0;
+
+}
+
+#endif
+
+
+/**
+ * Decode a whole subframe into its sample buffer, its header included. Once
+ * decoded, the samples have their wasted bits back but are still to be
+ * decorrelated in case of stereo encoding.
+ *
+ * @param data_input The subframe is read from there.
+ * @param frame_info Provide usefull informations like the number of samples
+ *                   and the channel assignement.
+ * @param channel_nb Indicate which channel in the channel assignement we are
+ *                   currently decoding.
+ *
+ * @return Return 0 if successful, -1 else.
+ */
+static int decode_subframe(data_input_t* data_input, frame_info_t* frame_info, uint8_t channel_nb) {
+
+    subframe_info_t* subframe = frame_info->subframes_info + channel_nb;
+    int error_code = 0;
+
+    if(read_subframe_header(data_input, subframe) == -1)
+        return -1;
+
+    /* The side channel has one more bit. */
+    if((((frame_info->channel_assignement == LEFT_SIDE) || (frame_info->channel_assignement == MID_SIDE)) && (channel_nb == 1)) || ((frame_info->channel_assignement == RIGHT_SIDE) && (channel_nb == 0)))
+        subframe->bits_per_sample = frame_info->bits_per_sample + 1;
+    else
+        subframe->bits_per_sample = frame_info->bits_per_sample;
+
+    if(subframe->wasted_bits_per_sample >= subframe->bits_per_sample) {
+        fprintf(stderr, "Invalid number of wasted bits per sample\n");
+        return -1;
+    }
+
+#ifdef DECODE_WIDE_SIDE
+    if(subframe->bits_per_sample > 32)
+        return decode_wide_subframe(data_input, subframe, frame_info->side_samples, frame_info->block_size);
+#endif
+
+    if(subframe->type == SUBFRAME_CONSTANT)
+        error_code = decode_constant(data_input, subframe, frame_info->block_size);
+    else if(subframe->type == SUBFRAME_VERBATIM)
+        error_code = decode_verbatim(data_input, subframe, frame_info->block_size);
+    else if((SUBFRAME_FIXED_LOW <= subframe->type) && (subframe->type <= SUBFRAME_FIXED_HIGH))
+        error_code = decode_fixed(data_input, subframe, frame_info->block_size);
+    else if((SUBFRAME_LPC_LOW <= subframe->type) && (subframe->type <= SUBFRAME_LPC_HIGH))
+        error_code = decode_lpc(data_input, subframe, frame_info->block_size);
+    else {
+        fprintf(stderr, "Invalid subframe type\n");
+        return -1;
+    }
 
-        if(*error_code == -1)
+    if(error_code == -1)
+        return -1;
+
+    if(subframe->wasted_bits_per_sample) {
+        int32_t* sample = subframe->samples;
+        int32_t* last_sample = subframe->samples + frame_info->block_size;
+
+        for(; sample < last_sample; ++sample)
+            *sample = (int32_t)((uint32_t)*sample << subframe->wasted_bits_per_sample);
+    }
+
+    return 0;
+
+}
+
+
+/**
+ * Decode an entire frame into the sample buffers. The decoded frame consists
+ * of a frame header and one or more couple of subframe headers and data. Once
+ * decoded, the samples are decorrelated, unless it is left to the output, and
+ * ready to be outputed. The CRC-8 of the header and the CRC-16 of the frame
+ * are checked as told by the input.
+ *
+ * @param data_input      Parameters, warm-up samples and residuals are read
+ *                        from there.
+ * @param bits_per_sample Number of bits per sample coming from the stream info
+ *                        block.
+ * @param max_block_size  The maximum number of samples in a block that is the
+ *                        size of the sample buffer of each channel.
+ * @param frame_info      The frame being decoded whose number of channels and
+ *                        sample buffers are already set.
+ *
+ * @return Return 1 if successful, 0 if the previous frame was probably the
+ *         last because we hit an EOF or whatever else relevant in this case or
+ *         -1 in case of an unexpected error.
+ */
+static int decode_frame_samples(data_input_t* data_input, uint8_t bits_per_sample, uint16_t max_block_size, frame_info_t* frame_info) {
+
+    int error_code = 0;
+    uint16_t crc = 0;
+    uint8_t channel_nb = 0;
+
+    error_code = read_frame_header(data_input, bits_per_sample, frame_info);
+    if(error_code == -1)
+        return -1;
+
+    if(error_code == 0)
+        return 0;
+
+    #ifdef STEREO_ONLY
+    if((frame_info->channel_assignement != LEFT_RIGHT) && (frame_info->channel_assignement != LEFT_SIDE) && (frame_info->channel_assignement != RIGHT_SIDE) && (frame_info->channel_assignement != MID_SIDE)) {
+        fprintf(stderr, "Stereo only is supported\n");
+        return -1;
+    }
+    #endif
+
+    if(frame_info->bits_per_sample != bits_per_sample) {
+        fprintf(stderr, "The number of bits per sample differs from the stream one\n");
+        return -1;
+    }
+
+    if(frame_info->block_size > max_block_size) {
+        fprintf(stderr, "The block size is bigger than the maximum one\n");
+        return -1;
+    }
+
+    if(((frame_info->channel_assignement < LEFT_SIDE) ? frame_info->channel_assignement + 1 : 2) != frame_info->nb_channels) {
+        fprintf(stderr, "The number of channels differs from the stream one\n");
+        return -1;
+    }
+
+    for(; channel_nb < frame_info->nb_channels; ++channel_nb)
+        if(decode_subframe(data_input, frame_info, channel_nb) == -1)
+            return -1;
+
+    /* padding */
+    if(data_input->shift != 0) {
+        data_input->shift = 0;
+        ++data_input->position;
+    }
+
+    if(data_input->crc_check != CRC_CHECK_OFF)
+        update_frame_crc16(data_input);
+
+    /* frame footer */
+    crc = get_shifted_bits(data_input, 16, &error_code);
+    if(error_code == -1)
+        return -1;
+
+    if((data_input->crc_check != CRC_CHECK_OFF) && (crc != data_input->crc16)) {
+        fprintf(stderr, "The CRC-16 of a frame does not match\n");
+        if(data_input->crc_check == CRC_CHECK_STRICT)
+            return -1;
+    }
+
+    if(((frame_info->channel_assignement == LEFT_SIDE) || (frame_info->channel_assignement == RIGHT_SIDE) || (frame_info->channel_assignement == MID_SIDE)) && !frame_info->is_decorrelation_fused) {
+#ifdef DECODE_WIDE_SIDE
+        if(frame_info->bits_per_sample == 32)
+            decorrelate_wide_side(frame_info->subframes_info[0].samples, frame_info->subframes_info[1].samples, frame_info->side_samples, frame_info->channel_assignement, frame_info->block_size);
+        else
+#endif
+            get_decorrelate_func(frame_info->channel_assignement)(frame_info->subframes_info[0].samples, frame_info->subframes_info[1].samples, frame_info->block_size);
+    }
+
+    return 1;
+
+}
+
+
+/**
+ * Output the decoded samples of a frame. The samples are interleaved into the
+ * output buffer which is dumped each time it gets full. The samples to skip
+ * after a seek and the ones past the output limit are dropped. The outputed
+ * samples are also hashed if the output asks for it and not packed at all for
+ * a null output.
+ *
+ * @param data_output    The decoded samples are outputed there.
+ * @param max_block_size The maximum number of samples in a block that is the
+ *                       size of the sample buffer of each channel.
+ * @param frame_info     The decoded frame.
+ *
+ * @return Return 0 if successful, 1 if the output limit is reached or -1 if
+ *         an error occured.
+ */
+static int output_frame(data_output_t* data_output, uint16_t max_block_size, frame_info_t* frame_info) {
+
+    uint16_t crt_sample = 0;
+    uint16_t last_sample = frame_info->block_size;
+    pack_func_t pack_func = data_output->pack_func;
+
+    /* A stereo encoded frame left correlated is decorrelated while packed. */
+    if(frame_info->is_decorrelation_fused && (frame_info->channel_assignement >= LEFT_SIDE))
+        pack_func = data_output->decorrelate_pack_funcs[frame_info->channel_assignement - LEFT_SIDE];
+
+    /* Samples before the one seeked to are dropped. */
+    if(data_output->nb_samples_to_skip > 0) {
+        if(data_output->nb_samples_to_skip >= frame_info->block_size) {
+            data_output->nb_samples_to_skip -= frame_info->block_size;
             return 0;
+        }
+
+        crt_sample = data_output->nb_samples_to_skip;
+        data_output->nb_samples_to_skip = 0;
+    }
+
+    if(data_output->is_limited) {
+        if(data_output->nb_samples_to_output <= (sample_number_t)(last_sample - crt_sample))
+            last_sample = crt_sample + data_output->nb_samples_to_output;
+
+        data_output->nb_samples_to_output -= last_sample - crt_sample;
+    }
+
+    if((data_output->md5_context != NULL) && (crt_sample < last_sample))
+        md5_update_samples(data_output->md5_context, frame_info->subframes_info[0].samples + crt_sample, max_block_size, frame_info->nb_channels, frame_info->bits_per_sample, last_sample - crt_sample);
+
+    while((data_output->buffer != NULL) && (crt_sample < last_sample)) {
+        uint16_t nb_samples = put_samples(data_output, pack_func, frame_info->subframes_info[0].samples + crt_sample, max_block_size, frame_info->nb_channels, frame_info->bits_per_sample, last_sample - crt_sample);
+
+        crt_sample += nb_samples;
+        if(crt_sample == last_sample)
+            break;
+
+        if((nb_samples == 0) && (data_output->position == 0)) {
+            fprintf(stderr, "The output buffer is too small\n");
+            return -1;
+        }
+
+        if(flush_buffer(data_output) == -1)
+            return -1;
+    }
+
+    return (data_output->is_limited && (data_output->nb_samples_to_output == 0)) ? 1 : 0;
+
+}
+
+
+/**
+ * Output the samples concealing the ones of damaged frames, silence or the
+ * previous frame repeated as many times as needed.
+ *
+ * @param data_output     The concealing samples are outputed there.
+ * @param bits_per_sample Number of bits per sample coming from the stream info
+ *                        block.
+ * @param max_block_size  The maximum number of samples in a block.
+ * @param frame_info      The frame whose number of channels is used, its
+ *                        header may be a rejected one.
+ * @param resync_state    The concealing samples are there.
+ * @param nb_samples      The number of samples per channel to conceal.
+ *
+ * @return Return 0 if successful, 1 if the output limit is reached or -1 if
+ *         an error occured.
+ */
+static int output_concealment(data_output_t* data_output, uint8_t bits_per_sample, uint16_t max_block_size, const frame_info_t* frame_info, const resync_state_t* resync_state, sample_number_t nb_samples) {
+
+    frame_info_t concealing_frame_info = *frame_info;
+    uint16_t block_size = (resync_state->nb_samples > 0) ? resync_state->nb_samples : max_block_size;
+    int error_code = 0;
+
+    /* Nothing is taken from the frame header which may be a rejected one. */
+    if(block_size > max_block_size)
+        block_size = max_block_size;
+
+    concealing_frame_info.bits_per_sample = bits_per_sample;
+    concealing_frame_info.subframes_info[0].samples = resync_state->samples;
+    concealing_frame_info.channel_assignement = resync_state->channel_assignement;
+
+    while(nb_samples > 0) {
+        concealing_frame_info.block_size = (nb_samples < block_size) ? nb_samples : block_size;
+        if((error_code = output_frame(data_output, max_block_size, &concealing_frame_info)) != 0)
+            return error_code;
+
+        nb_samples -= concealing_frame_info.block_size;
+    }
+
+    return 0;
+
+}
 
-        subframe->previous_values[order - 1].next = subframe->previous_values;
-        subframe->next_out = subframe->previous_values;
 
-        subframe->lpc_precision = get_shifted_bits(data_input, 4, error_code) + 1;
-        if(*error_code == -1)
+/**
+ * Decode and output the next frame. If the input asks for it, a frame which
+ * cannot be decoded, from a lost synchro to a CRC not matching in strict mode,
+ * is skipped by going on from the next valid frame header which decodes. The
+ * byte offsets the decoding went from and to and the skipped samples are
+ * reported and, if the output asks for it, the skipped samples are concealed.
+ *
+ * @param data_input      The frame is read from there.
+ * @param data_output     The decoded samples are outputed there.
+ * @param bits_per_sample Number of bits per sample coming from the stream info
+ *                        block.
+ * @param max_block_size  The maximum number of samples in a block that is the
+ *                        size of the sample buffer of each channel.
+ * @param frame_info      The frame being decoded whose number of channels and
+ *                        sample buffers are already set.
+ * @param resync_state    What is needed to go on after damaged frames.
+ *
+ * @return Return 1 if successful, 0 if there is no frame left, no frame was
+ *         found after a damaged one or the output limit is reached or -1 in
+ *         case of an unexpected error.
+ */
+static int decode_next_frame(data_input_t* data_input, data_output_t* data_output, uint8_t bits_per_sample, uint16_t max_block_size, frame_info_t* frame_info, resync_state_t* resync_state) {
+
+    frame_header_t header;
+    sample_number_t first_sample = 0;
+    off_t frame_position = 0;
+    off_t damaged_position = -1;
+    int error_code = 0;
+
+    if(!data_input->should_resync) {
+        if((error_code = decode_frame_samples(data_input, bits_per_sample, max_block_size, frame_info)) < 1)
+            return error_code;
+    } else {
+        for(;;) {
+            if(should_refill_input_buffer(data_input, MAX_FRAME_HEADER_SIZE) && (refill_input_buffer(data_input) == -1))
+                return -1;
+
+            /* A damaged header does not tell where its frame starts in the
+               stream. */
+            frame_position = get_position(data_input);
+            first_sample = resync_state->next_sample;
+            if(parse_frame_header(data_input->buffer + data_input->position, data_input->read_size - data_input->position, &header))
+                first_sample = get_first_sample(&header, resync_state->block_size);
+
+            if((error_code = decode_frame_samples(data_input, bits_per_sample, max_block_size, frame_info)) != -1)
+                break;
+
+            if(damaged_position == -1)
+                damaged_position = frame_position;
+
+            if((error_code = find_frame_header(data_input, frame_position + 1, &header)) != 1)
+                break;
+        }
+
+        if(error_code == -1)
+            return -1;
+
+        if((error_code == 0) && (damaged_position == -1))
             return 0;
 
-        subframe->lpc_shift = convert_to_signed(get_shifted_bits(data_input, 5, error_code), 5);
-        if(*error_code == -1)
+        /* The damage goes on up to the end of the stream whose number of
+           samples, if known, tells how many are skipped. */
+        if(error_code == 0) {
+            if(resync_state->nb_stream_samples <= resync_state->next_sample) {
+                fprintf(stderr, "No frame found after byte %lld\n", (long long)damaged_position);
+                return 0;
+            }
+
+            fprintf(stderr, "No frame found after byte %lld, %llu samples skipped\n", (long long)damaged_position, (unsigned long long)(resync_state->nb_stream_samples - resync_state->next_sample));
+
+            if((resync_state->samples != NULL) && (output_concealment(data_output, bits_per_sample, max_block_size, frame_info, resync_state, resync_state->nb_stream_samples - resync_state->next_sample) == -1))
+                return -1;
+
             return 0;
+        }
 
-#define INIT_ONE_COEFF(data_input, subframe, index, error_code) \
-    do { \
-        (subframe)->coeffs[(index)] = convert_to_signed(get_shifted_bits((data_input), (subframe)->lpc_precision, (error_code)), (subframe)->lpc_precision); \
-    } while(0)
+        if(damaged_position != -1) {
+            if(first_sample >= resync_state->next_sample) {
+                fprintf(stderr, "Resynchronised from byte %lld to byte %lld, %llu samples skipped\n", (long long)damaged_position, (long long)frame_position, (unsigned long long)(first_sample - resync_state->next_sample));
+
+                if(resync_state->samples != NULL) {
+                    if((error_code = output_concealment(data_output, bits_per_sample, max_block_size, frame_info, resync_state, first_sample - resync_state->next_sample)) != 0)
+                        return (error_code == 1) ? 0 : -1;
+                } else if(data_output->nb_samples_to_skip > (first_sample - resync_state->next_sample)) {
+                    /* The samples to skip after a seek are counted from the
+                       first skipped one. */
+                    data_output->nb_samples_to_skip -= first_sample - resync_state->next_sample;
+                } else {
+                    data_output->nb_samples_to_skip = 0;
+                }
+            } else {
+                fprintf(stderr, "Resynchronised from byte %lld to byte %lld, unknown number of samples skipped\n", (long long)damaged_position, (long long)frame_position);
+            }
+        }
 
-        switch(order) {
-            case 32:
-                INIT_ONE_COEFF(data_input, subframe, 0, error_code);
-                /* FALLTHROUGH */
+        resync_state->next_sample = first_sample + frame_info->block_size;
 
-            case 31:
-                INIT_ONE_COEFF(data_input, subframe, order - 31, error_code);
-                /* FALLTHROUGH */
+        /* The frame is kept to be repeated in place of the next damaged ones. */
+        if((resync_state->samples != NULL) && (data_output->concealment == CONCEAL_REPEAT)) {
+            uint8_t channel_nb = 0;
 
-            case 30:
-                INIT_ONE_COEFF(data_input, subframe, order - 30, error_code);
-                /* FALLTHROUGH */
+            for(; channel_nb < frame_info->nb_channels; ++channel_nb)
+                memcpy(resync_state->samples + channel_nb * max_block_size, frame_info->subframes_info[0].samples + channel_nb * max_block_size, sizeof(int32_t) * frame_info->block_size);
 
-            case 29:
-                INIT_ONE_COEFF(data_input, subframe, order - 29, error_code);
-                /* FALLTHROUGH */
+            resync_state->nb_samples = frame_info->block_size;
+            resync_state->channel_assignement = frame_info->channel_assignement;
+        }
+    }
 
-            case 28:
-                INIT_ONE_COEFF(data_input, subframe, order - 28, error_code);
-                /* FALLTHROUGH */
+    if((error_code = output_frame(data_output, max_block_size, frame_info)) == 0)
+        return 1;
 
-            case 27:
-                INIT_ONE_COEFF(data_input, subframe, order - 27, error_code);
-                /* FALLTHROUGH */
+    return (error_code == 1) ? 0 : -1;
 
-            case 26:
-                INIT_ONE_COEFF(data_input, subframe, order - 26, error_code);
-                /* FALLTHROUGH */
+}
 
-            case 25:
-                INIT_ONE_COEFF(data_input, subframe, order - 25, error_code);
-                /* FALLTHROUGH */
 
-            case 24:
-                INIT_ONE_COEFF(data_input, subframe, order - 24, error_code);
-                /* FALLTHROUGH */
+/**
+ * Allocate the sample buffers of a frame, one after the other, and the one of
+ * the 64 bits side channel for 32 bits stereo streams.
+ *
+ * @param frame_info      The frame whose buffers are allocated.
+ * @param data_output     The output the frame is decoded for, which tells if
+ *                        the stereo decorrelation is left to its packing.
+ * @param bits_per_sample Number of bits per sample of the stream.
+ * @param nb_channels     The number of channels of the stream.
+ * @param max_block_size  The number of samples of each buffer.
+ *
+ * @return Return 0 if successful, -1 else.
+ */
+static int alloc_frame_buffers(frame_info_t* frame_info, const data_output_t* data_output, uint8_t bits_per_sample, uint8_t nb_channels, uint16_t max_block_size) {
 
-            case 23:
-                INIT_ONE_COEFF(data_input, subframe, order - 23, error_code);
-                /* FALLTHROUGH */
+    int32_t* samples = (int32_t*)malloc(sizeof(int32_t) * max_block_size * nb_channels);
+    uint8_t channel_nb = 0;
 
-            case 22:
-                INIT_ONE_COEFF(data_input, subframe, order - 22, error_code);
-                /* FALLTHROUGH */
+    if(samples == NULL) {
+        perror("An error occured while allocating the samples");
+        return -1;
+    }
 
-            case 21:
-                INIT_ONE_COEFF(data_input, subframe, order - 21, error_code);
-                /* FALLTHROUGH */
+    frame_info->nb_channels = nb_channels;
+    frame_info->is_decorrelation_fused = data_output->decorrelate_pack_funcs[0] != NULL;
+    for(; channel_nb < nb_channels; ++channel_nb)
+        frame_info->subframes_info[channel_nb].samples = samples + (channel_nb * max_block_size);
+
+#ifdef DECODE_WIDE_SIDE
+    /* Only the side channel of 32 bits streams needs 64 bits samples. */
+    frame_info->side_samples = NULL;
+    if((bits_per_sample == 32) && (nb_channels == 2)) {
+        frame_info->side_samples = (int64_t*)malloc(sizeof(int64_t) * max_block_size);
+        if(frame_info->side_samples == NULL) {
+            perror("An error occured while allocating the side samples");
+            free(samples);
+            return -1;
+        }
+    }
+#else
+    (void)bits_per_sample;
+#endif
 
-            case 20:
-                INIT_ONE_COEFF(data_input, subframe, order - 20, error_code);
-                /* FALLTHROUGH */
+    return 0;
 
-            case 19:
-                INIT_ONE_COEFF(data_input, subframe, order - 19, error_code);
-                /* FALLTHROUGH */
+}
 
-            case 18:
-                INIT_ONE_COEFF(data_input, subframe, order - 18, error_code);
-                /* FALLTHROUGH */
 
-            case 17:
-                INIT_ONE_COEFF(data_input, subframe, order - 17, error_code);
-                /* FALLTHROUGH */
+/**
+ * Free the buffers allocated by alloc_frame_buffers.
+ *
+ * @param frame_info The frame whose buffers are freed.
+ */
+static void free_frame_buffers(frame_info_t* frame_info) {
 
-            case 16:
-                INIT_ONE_COEFF(data_input, subframe, order - 16, error_code);
-                /* FALLTHROUGH */
+    free(frame_info->subframes_info[0].samples);
+#ifdef DECODE_WIDE_SIDE
+    free(frame_info->side_samples);
+#endif
 
-            case 15:
-                INIT_ONE_COEFF(data_input, subframe, order - 15, error_code);
-                /* FALLTHROUGH */
+}
 
-            case 14:
-                INIT_ONE_COEFF(data_input, subframe, order - 14, error_code);
-                /* FALLTHROUGH */
 
-            case 13:
-                INIT_ONE_COEFF(data_input, subframe, order - 13, error_code);
-                /* FALLTHROUGH */
+/**
+ * Init what is needed to go on after damaged frames, allocating the samples
+ * output in their place if the output conceals them.
+ *
+ * @param resync_state   What is needed to go on after damaged frames.
+ * @param data_output    The output telling how damaged frames are concealed.
+ * @param stream_info    The stream info of the stream.
+ * @param max_block_size The maximum number of samples in a block.
+ * @param first_sample   The number of the first sample of the frame the input
+ *                       is at.
+ *
+ * @return Return 0 if successful, -1 else.
+ */
+static int init_resync_state(resync_state_t* resync_state, const data_output_t* data_output, const stream_info_t* stream_info, uint16_t max_block_size, sample_number_t first_sample) {
 
-            case 12:
-                INIT_ONE_COEFF(data_input, subframe, order - 12, error_code);
-                /* FALLTHROUGH */
+    uint8_t nb_channels = stream_info->nb_channels;
 
-            case 11:
-                INIT_ONE_COEFF(data_input, subframe, order - 11, error_code);
-                /* FALLTHROUGH */
+    resync_state->next_sample = first_sample;
+    resync_state->samples = NULL;
+    resync_state->nb_samples = 0;
+    resync_state->channel_assignement = nb_channels - 1;
+    /* A maximum block size below the minimum one allowed is not to be
+       trusted. */
+    resync_state->block_size = (stream_info->max_block_size < 16) ? 0 : stream_info->max_block_size;
+#ifndef DISALLOW_64_BITS
+    resync_state->nb_stream_samples = stream_info->nb_samples;
+#else
+    resync_state->nb_stream_samples = 0;
+#endif
 
-            case 10:
-                INIT_ONE_COEFF(data_input, subframe, order - 10, error_code);
-                /* FALLTHROUGH */
+    if(data_output->concealment == CONCEAL_OFF)
+        return 0;
 
-            case 9:
-                INIT_ONE_COEFF(data_input, subframe, order - 9, error_code);
-                /* FALLTHROUGH */
+    /* Until a frame is decoded, there is only silence to repeat. */
+    resync_state->samples = (int32_t*)calloc((size_t)max_block_size * nb_channels, sizeof(int32_t));
+    if(resync_state->samples == NULL) {
+        perror("An error occured while allocating the concealment samples");
+        return -1;
+    }
 
-            case 8:
-                INIT_ONE_COEFF(data_input, subframe, order - 8, error_code);
-                /* FALLTHROUGH */
+    return 0;
 
-            case 7:
-                INIT_ONE_COEFF(data_input, subframe, order - 7, error_code);
-                /* FALLTHROUGH */
+}
+
+
+/**
+ * Free the samples output in place of the ones of damaged frames.
+ *
+ * @param resync_state What is needed to go on after damaged frames.
+ */
+static void free_resync_state(resync_state_t* resync_state) {
+
+    free(resync_state->samples);
+    resync_state->samples = NULL;
+
+}
+
+
+/**
+ * Set up the kernels used for a stream and check that it can be outputed.
+ *
+ * @param data_output     The pack functions of the stream are set there.
+ * @param bits_per_sample Number of bits per sample of the stream.
+ * @param nb_channels     The number of channels of the stream.
+ *
+ * @return Return 0 if successful, -1 else.
+ */
+static int init_stream_kernels(data_output_t* data_output, uint8_t bits_per_sample, uint8_t nb_channels) {
+
+    uint8_t channel_assignement = LEFT_SIDE;
+
+    #ifdef STEREO_ONLY
+    if(nb_channels > 2) {
+        fprintf(stderr, "Stereo only is supported\n");
+        return -1;
+    }
+    #endif
+
+    init_lpc_kernels();
+    init_stereo_kernels();
+    init_pack_kernels();
+
+    data_output->pack_func = get_pack_func(bits_per_sample, nb_channels);
+    if(data_output->pack_func == NULL) {
+        fprintf(stderr, "bits per sample not supported: %u\n", bits_per_sample);
+        return -1;
+    }
+
+    /* The stereo decorrelation is fused with the packing when there is one
+       and the decorrelated samples are not hashed. */
+    for(; channel_assignement <= MID_SIDE; ++channel_assignement)
+        data_output->decorrelate_pack_funcs[channel_assignement - LEFT_SIDE] = ((nb_channels == 2) && (data_output->buffer != NULL) && (data_output->md5_context == NULL)) ? get_decorrelate_pack_func(bits_per_sample, channel_assignement) : NULL;
+
+    return 0;
+
+}
+
+
+/**
+ * Decode the flac metedata stream info and seek table and skip the others.
+ *
+ * @param data_input  The metadata are read from there.
+ * @param stream_info The resulting useful informations are put there.
+ *
+ * @return Return 0 if successful, -1 else.
+ */
+int decode_flac_metadata(data_input_t* data_input, stream_info_t* stream_info) {
 
-            case 6:
-                INIT_ONE_COEFF(data_input, subframe, order - 6, error_code);
-                /* FALLTHROUGH */
+    if(get_flac_stream_info(data_input, stream_info) == -1)
+        return -1;
 
-            case 5:
-                INIT_ONE_COEFF(data_input, subframe, order - 5, error_code);
-                /* FALLTHROUGH */
+    if(skip_metadata(data_input, stream_info) == -1)
+        return -1;
 
-            case 4:
-                INIT_ONE_COEFF(data_input, subframe, order - 4, error_code);
-                /* FALLTHROUGH */
+    stream_info->first_frame_offset = get_position(data_input);
 
-            case 3:
-                INIT_ONE_COEFF(data_input, subframe, order - 3, error_code);
-                /* FALLTHROUGH */
+    return 0;
 
-            case 2:
-                INIT_ONE_COEFF(data_input, subframe, order - 2, error_code);
-                /* FALLTHROUGH */
+}
 
-            case 1:
-                INIT_ONE_COEFF(data_input, subframe, order - 1, error_code);
-        }
 
-#undef INIT_ONE_COEFF
+/**
+ * Free the seek table of the stream info.
+ *
+ * @param stream_info The stream info to free.
+ */
+void free_stream_info(stream_info_t* stream_info) {
 
-        if(*error_code == -1)
-            return 0;
+    free(stream_info->seek_points);
+    stream_info->seek_points = NULL;
+    stream_info->nb_seek_points = 0;
 
-        residual_coding_method = get_shifted_bits(data_input, 2, error_code);
-        if(*error_code == -1)
-            return 0;
+}
 
-        switch(residual_coding_method) {
-            case 0:
-                subframe->residual_info.rice_parameter_size = 4;
-                break;
 
-            case 1:
-                subframe->residual_info.rice_parameter_size = 5;
-                break;
+/**
+ * Tell if a seek point leads to the header of its frame. The seek table of the
+ * stream may be bogus and the seek index file stale.
+ *
+ * @param data_input    The stream is read from there and put at the seek
+ *                      point.
+ * @param position      The position in the stream of the seek point.
+ * @param sample_number The number of the first sample of the frame of the seek
+ *                      point.
+ * @param block_size    The block size of the fixed blocking strategy stream, 0
+ *                      if unknown.
+ *
+ * @return Return 1 if the header of the frame is at the seek point, 0 if it is
+ *         not or -1 in case of an unexpected error.
+ */
+static int is_seek_point_valid(data_input_t* data_input, off_t position, sample_number_t sample_number, uint16_t block_size) {
 
-            default:
-                *error_code = -1;
-                return 0;
-        }
+    frame_header_t header;
 
-        subframe->residual_info.rice_parameter = 0;
-        subframe->residual_info.has_escape_code = 0;
-        subframe->residual_info.escape_bits_per_sample = 0;
-        subframe->residual_info.remaining_nb_samples = 0;
-        subframe->residual_info.is_first_partition = 1;
+    if((position < 0) || (data_input->is_mapped && (position >= data_input->read_size)))
+        return 0;
 
-        subframe->residual_info.partition_order = get_shifted_bits(data_input, 4, error_code);
-        if(*error_code == -1)
-            return 0;
+    if(skip_to_position(data_input, position) == -1)
+        return -1;
 
-        subframe->has_parameters = 1;
-    }
+    if(should_refill_input_buffer(data_input, MAX_FRAME_HEADER_SIZE) && (refill_input_buffer(data_input) == -1))
+        return -1;
 
-    if(crt_sample < order) {
-        switch(order - crt_sample) {
-            case 32:
-                OUTPUT_ONE_WARMUP(data_output, frame_info, subframe, channel_nb, 0, crt_sample, error_code);
-                /* FALLTHROUGH */
+    if(!parse_frame_header(data_input->buffer + data_input->position, data_input->read_size - data_input->position, &header))
+        return 0;
 
-            case 31:
-                OUTPUT_ONE_WARMUP(data_output, frame_info, subframe, channel_nb, crt_sample, crt_sample, error_code);
-                /* FALLTHROUGH */
+    return get_first_sample(&header, block_size) == sample_number;
 
-            case 30:
-                OUTPUT_ONE_WARMUP(data_output, frame_info, subframe, channel_nb, crt_sample, crt_sample, error_code);
-                /* FALLTHROUGH */
+}
 
-            case 29:
-                OUTPUT_ONE_WARMUP(data_output, frame_info, subframe, channel_nb, crt_sample, crt_sample, error_code);
-                /* FALLTHROUGH */
 
-            case 28:
-                OUTPUT_ONE_WARMUP(data_output, frame_info, subframe, channel_nb, crt_sample, crt_sample, error_code);
-                /* FALLTHROUGH */
+/**
+ * Put the input at the frame holding a sample and set the output to drop the
+ * samples of the frame before it. The search starts from the closest seek
+ * point before the sample, or from the first frame without a seek table or if
+ * the seek point does not lead to the header of its frame, and goes on by
+ * looking for the frame headers.
+ *
+ * @param data_input    The stream is read from there.
+ * @param data_output   The decoded samples will be outputed there.
+ * @param stream_info   The stream info and seek table of the stream.
+ * @param sample_number The number of the sample to seek to.
+ * @param first_sample  The number of the first sample of the frame the input
+ *                      is put at is put there.
+ *
+ * @return Return 0 if successful, -1 else.
+ */
+int decode_flac_seek(data_input_t* data_input, data_output_t* data_output, const stream_info_t* stream_info, sample_number_t sample_number, sample_number_t* first_sample) {
 
-            case 27:
-                OUTPUT_ONE_WARMUP(data_output, frame_info, subframe, channel_nb, crt_sample, crt_sample, error_code);
-                /* FALLTHROUGH */
+    off_t frame_position = stream_info->first_frame_offset;
+    frame_header_t header;
+    sample_number_t frame_first_sample = 0;
+    uint32_t low = 0;
+    uint32_t high = stream_info->nb_seek_points;
+    int error_code = 0;
 
-            case 26:
-                OUTPUT_ONE_WARMUP(data_output, frame_info, subframe, channel_nb, crt_sample, crt_sample, error_code);
-                /* FALLTHROUGH */
+#ifndef DISALLOW_64_BITS
+    if((stream_info->nb_samples != 0) && (sample_number >= stream_info->nb_samples)) {
+        fprintf(stderr, "Cannot seek past the end of the stream\n");
+        return -1;
+    }
+#endif
 
-            case 25:
-                OUTPUT_ONE_WARMUP(data_output, frame_info, subframe, channel_nb, crt_sample, crt_sample, error_code);
-                /* FALLTHROUGH */
+    /* The last seek point at or before the sample. */
+    while(low < high) {
+        uint32_t middle = low + ((high - low) >> 1);
 
-            case 24:
-                OUTPUT_ONE_WARMUP(data_output, frame_info, subframe, channel_nb, crt_sample, crt_sample, error_code);
-                /* FALLTHROUGH */
+        if(stream_info->seek_points[middle].sample_number <= sample_number)
+            low = middle + 1;
+        else
+            high = middle;
+    }
 
-            case 23:
-                OUTPUT_ONE_WARMUP(data_output, frame_info, subframe, channel_nb, crt_sample, crt_sample, error_code);
-                /* FALLTHROUGH */
+    if(low > 0) {
+        /* A maximum block size below the minimum one allowed is not to be
+           trusted. */
+        switch(is_seek_point_valid(data_input, frame_position + stream_info->seek_points[low - 1].offset, stream_info->seek_points[low - 1].sample_number, (stream_info->max_block_size < 16) ? 0 : stream_info->max_block_size)) {
+            case -1:
+                return -1;
 
-            case 22:
-                OUTPUT_ONE_WARMUP(data_output, frame_info, subframe, channel_nb, crt_sample, crt_sample, error_code);
-                /* FALLTHROUGH */
+            case 0:
+                fprintf(stderr, "The seek point of sample %llu does not lead to its frame, the frames are scanned instead\n", (unsigned long long)stream_info->seek_points[low - 1].sample_number);
+                break;
 
-            case 21:
-                OUTPUT_ONE_WARMUP(data_output, frame_info, subframe, channel_nb, crt_sample, crt_sample, error_code);
-                /* FALLTHROUGH */
+            default:
+                frame_position += stream_info->seek_points[low - 1].offset;
+                frame_first_sample = stream_info->seek_points[low - 1].sample_number;
+        }
+    }
 
-            case 20:
-                OUTPUT_ONE_WARMUP(data_output, frame_info, subframe, channel_nb, crt_sample, crt_sample, error_code);
-                /* FALLTHROUGH */
+    if(skip_to_position(data_input, frame_position) == -1)
+        return -1;
 
-            case 19:
-                OUTPUT_ONE_WARMUP(data_output, frame_info, subframe, channel_nb, crt_sample, crt_sample, error_code);
-                /* FALLTHROUGH */
+    /* Frames are checked to follow each other so each one starts where the
+       previous one ends. */
+    while((error_code = read_frame_bytes(data_input, &header, NULL)) == 1) {
+        if(sample_number < (frame_first_sample + header.block_size)) {
+            data_output->nb_samples_to_skip = sample_number - frame_first_sample;
+            *first_sample = frame_first_sample;
+            return skip_to_position(data_input, frame_position);
+        }
 
-            case 18:
-                OUTPUT_ONE_WARMUP(data_output, frame_info, subframe, channel_nb, crt_sample, crt_sample, error_code);
-                /* FALLTHROUGH */
+        frame_first_sample += header.block_size;
+        frame_position = get_position(data_input);
+    }
 
-            case 17:
-                OUTPUT_ONE_WARMUP(data_output, frame_info, subframe, channel_nb, crt_sample, crt_sample, error_code);
-                /* FALLTHROUGH */
+    if(error_code == 0)
+        fprintf(stderr, "Cannot seek past the end of the stream\n");
 
-            case 16:
-                OUTPUT_ONE_WARMUP(data_output, frame_info, subframe, channel_nb, crt_sample, crt_sample, error_code);
-                /* FALLTHROUGH */
+    return -1;
 
-            case 15:
-                OUTPUT_ONE_WARMUP(data_output, frame_info, subframe, channel_nb, crt_sample, crt_sample, error_code);
-                /* FALLTHROUGH */
+}
 
-            case 14:
-                OUTPUT_ONE_WARMUP(data_output, frame_info, subframe, channel_nb, crt_sample, crt_sample, error_code);
-                /* FALLTHROUGH */
 
-            case 13:
-                OUTPUT_ONE_WARMUP(data_output, frame_info, subframe, channel_nb, crt_sample, crt_sample, error_code);
-                /* FALLTHROUGH */
+/**
+ * Decode flac stream into the output sink until the end is reached or the
+ * output limit, if any, is. If the input asks for it, the decoding goes on
+ * after damaged frames.
+ *
+ * @param data_input   The stream is read from there.
+ * @param data_output  The decoded samples are outputed there.
+ * @param stream_info  The stream info of the stream. Its maximum block size
+ *                     sets the size of the per channel buffers frames are
+ *                     decoded into.
+ * @param first_sample The number of the first sample of the frame the input is
+ *                     at, 0 unless it was put there by decode_flac_seek.
+ *
+ * @return Return 0 if successful, -1 else.
+ */
+int decode_flac_data(data_input_t* data_input, data_output_t* data_output, const stream_info_t* stream_info, sample_number_t first_sample) {
 
-            case 12:
-                OUTPUT_ONE_WARMUP(data_output, frame_info, subframe, channel_nb, crt_sample, crt_sample, error_code);
-                /* FALLTHROUGH */
+    int error_code = 0;
+    frame_info_t frame_info;
+    resync_state_t resync_state;
+    uint8_t bits_per_sample = stream_info->bits_per_sample;
+    uint8_t nb_channels = stream_info->nb_channels;
+    uint16_t max_block_size = stream_info->max_block_size;
 
-            case 11:
-                OUTPUT_ONE_WARMUP(data_output, frame_info, subframe, channel_nb, crt_sample, crt_sample, error_code);
-                /* FALLTHROUGH */
+    /* A maximum block size below the minimum one allowed is not to be trusted. */
+    if(max_block_size < 16)
+        max_block_size = MAX_BLOCK_SIZE;
 
-            case 10:
-                OUTPUT_ONE_WARMUP(data_output, frame_info, subframe, channel_nb, crt_sample, crt_sample, error_code);
-                /* FALLTHROUGH */
+    if(init_stream_kernels(data_output, bits_per_sample, nb_channels) == -1)
+        return -1;
 
-            case 9:
-                OUTPUT_ONE_WARMUP(data_output, frame_info, subframe, channel_nb, crt_sample, crt_sample, error_code);
-                /* FALLTHROUGH */
+    if(alloc_frame_buffers(&frame_info, data_output, bits_per_sample, nb_channels, max_block_size) == -1)
+        return -1;
 
-            case 8:
-                OUTPUT_ONE_WARMUP(data_output, frame_info, subframe, channel_nb, crt_sample, crt_sample, error_code);
-                /* FALLTHROUGH */
+    if(init_resync_state(&resync_state, data_output, stream_info, max_block_size, first_sample) == -1) {
+        free_frame_buffers(&frame_info);
+        return -1;
+    }
 
-            case 7:
-                OUTPUT_ONE_WARMUP(data_output, frame_info, subframe, channel_nb, crt_sample, crt_sample, error_code);
-                /* FALLTHROUGH */
+    do
+        error_code = decode_next_frame(data_input, data_output, bits_per_sample, max_block_size, &frame_info, &resync_state);
+    while(error_code > 0);
 
-            case 6:
-                OUTPUT_ONE_WARMUP(data_output, frame_info, subframe, channel_nb, crt_sample, crt_sample, error_code);
-                /* FALLTHROUGH */
+    free_resync_state(&resync_state);
+    free_frame_buffers(&frame_info);
 
-            case 5:
-                OUTPUT_ONE_WARMUP(data_output, frame_info, subframe, channel_nb, crt_sample, crt_sample, error_code);
-                /* FALLTHROUGH */
+    if(error_code == -1)
+        return -1;
 
-            case 4:
-                OUTPUT_ONE_WARMUP(data_output, frame_info, subframe, channel_nb, crt_sample, crt_sample, error_code);
-                /* FALLTHROUGH */
+    return flush_buffer(data_output);
 
-            case 3:
-                OUTPUT_ONE_WARMUP(data_output, frame_info, subframe, channel_nb, crt_sample, crt_sample, error_code);
-                /* FALLTHROUGH */
+}
 
-            case 2:
-                OUTPUT_ONE_WARMUP(data_output, frame_info, subframe, channel_nb, crt_sample, crt_sample, error_code);
-                /* FALLTHROUGH */
+/**
+ * A stream decoded in lock step with others.
+ */
+typedef struct {
+    frame_info_t frame_info;    /**< Where the frames are decoded. */
+    uint16_t max_block_size;    /**< The size of the sample buffers. */
+    resync_state_t resync_state;/**< What is needed to go on after damaged
+                                     frames. */
+    uint8_t is_decoding;        /**< Is the stream still being decoded? */
+} lock_step_stream_t;
 
-            case 1:
-                OUTPUT_ONE_WARMUP(data_output, frame_info, subframe, channel_nb, crt_sample, crt_sample, error_code);
-                goto decode_lpc_subframe;
-        }
 
-        if(*error_code == -1)
-            return 0;
+/**
+ * Decode several flac streams into their own output sink, one frame of each
+ * stream in turn, until the end or the output limit, if any, of each one is
+ * reached. Decoding the streams alongside lets their outputs go on together,
+ * like their md5 hashed in lanes. A stream failing to decode is left out
+ * while the other ones go on.
+ *
+ * @param data_inputs  The streams are read from there.
+ * @param data_outputs The decoded samples of each stream are outputed there.
+ * @param stream_infos The stream info of each stream.
+ * @param results      The result of each stream is put there, 0 if it was
+ *                     successfully decoded, -1 else.
+ * @param nb_streams   The number of streams.
+ *
+ * @return Return 0 if every stream was successfully decoded, -1 else.
+ */
+int decode_flac_data_in_lock_step(data_input_t* data_inputs, data_output_t* data_outputs, const stream_info_t* stream_infos, int* results, uint8_t nb_streams) {
 
-        SKIP_INPUT(data_input, frame_info, subframe, channel_nb, order, order, error_code);
-        return crt_sample;
-    } else {
-        *error_code = put_shifted_bits(data_output, subframe->next_out->value << subframe->wasted_bits_per_sample, subframe->bits_per_sample, frame_info->channel_assignement, channel_nb);
-        if(*error_code == -1)
-            return 0;
+    lock_step_stream_t* streams = (lock_step_stream_t*)malloc(sizeof(lock_step_stream_t) * nb_streams);
+    uint8_t nb_decoding_streams = 0;
+    uint8_t stream_nb = 0;
+    int error_code = 0;
 
-        ++crt_sample;
-        subframe->next_out = subframe->next_out->next;
+    if(streams == NULL) {
+        perror("An error occured while allocating the lock step streams");
+        return -1;
     }
 
-decode_lpc_subframe:;
-    for(; crt_sample < frame_info->block_size; ++crt_sample) {
-        DECODE_TYPE value = 0;
-        previous_value_t* crt = subframe->next_out;
-
-#define ADD_TO_VALUE(subframe, crt, index, value) \
-    do { \
-        (value) += (subframe)->coeffs[(index)] * (crt)->value; \
-    } while(0)
-
-        switch(order) {
-            case 32:
-                ADD_TO_VALUE(subframe, crt, 31, value);
-                crt = crt->next;
-                /* FALLTHROUGH */
-
-            case 31:
-                ADD_TO_VALUE(subframe, crt, 30, value);
-                crt = crt->next;
-                /* FALLTHROUGH */
-
-            case 30:
-                ADD_TO_VALUE(subframe, crt, 29, value);
-                crt = crt->next;
-                /* FALLTHROUGH */
-
-            case 29:
-                ADD_TO_VALUE(subframe, crt, 28, value);
-                crt = crt->next;
-                /* FALLTHROUGH */
-
-            case 28:
-                ADD_TO_VALUE(subframe, crt, 27, value);
-                crt = crt->next;
-                /* FALLTHROUGH */
-
-            case 27:
-                ADD_TO_VALUE(subframe, crt, 26, value);
-                crt = crt->next;
-                /* FALLTHROUGH */
-
-            case 26:
-                ADD_TO_VALUE(subframe, crt, 25, value);
-                crt = crt->next;
-                /* FALLTHROUGH */
-
-            case 25:
-                ADD_TO_VALUE(subframe, crt, 24, value);
-                crt = crt->next;
-                /* FALLTHROUGH */
-
-            case 24:
-                ADD_TO_VALUE(subframe, crt, 23, value);
-                crt = crt->next;
-                /* FALLTHROUGH */
-
-            case 23:
-                ADD_TO_VALUE(subframe, crt, 22, value);
-                crt = crt->next;
-                /* FALLTHROUGH */
-
-            case 22:
-                ADD_TO_VALUE(subframe, crt, 21, value);
-                crt = crt->next;
-                /* FALLTHROUGH */
-
-            case 21:
-                ADD_TO_VALUE(subframe, crt, 20, value);
-                crt = crt->next;
-                /* FALLTHROUGH */
-
-            case 20:
-                ADD_TO_VALUE(subframe, crt, 19, value);
-                crt = crt->next;
-                /* FALLTHROUGH */
-
-            case 19:
-                ADD_TO_VALUE(subframe, crt, 18, value);
-                crt = crt->next;
-                /* FALLTHROUGH */
-
-            case 18:
-                ADD_TO_VALUE(subframe, crt, 17, value);
-                crt = crt->next;
-                /* FALLTHROUGH */
-
-            case 17:
-                ADD_TO_VALUE(subframe, crt, 16, value);
-                crt = crt->next;
-                /* FALLTHROUGH */
-
-            case 16:
-                ADD_TO_VALUE(subframe, crt, 15, value);
-                crt = crt->next;
-                /* FALLTHROUGH */
+    for(; stream_nb < nb_streams; ++stream_nb) {
+        lock_step_stream_t* stream = streams + stream_nb;
 
-            case 15:
-                ADD_TO_VALUE(subframe, crt, 14, value);
-                crt = crt->next;
-                /* FALLTHROUGH */
+        /* A maximum block size below the minimum one allowed is not to be
+           trusted. */
+        stream->max_block_size = stream_infos[stream_nb].max_block_size < 16 ? MAX_BLOCK_SIZE : stream_infos[stream_nb].max_block_size;
+        stream->is_decoding = 0;
+        results[stream_nb] = -1;
 
-            case 14:
-                ADD_TO_VALUE(subframe, crt, 13, value);
-                crt = crt->next;
-                /* FALLTHROUGH */
+        if(init_stream_kernels(data_outputs + stream_nb, stream_infos[stream_nb].bits_per_sample, stream_infos[stream_nb].nb_channels) == -1)
+            continue;
 
-            case 13:
-                ADD_TO_VALUE(subframe, crt, 12, value);
-                crt = crt->next;
-                /* FALLTHROUGH */
+        if(alloc_frame_buffers(&stream->frame_info, data_outputs + stream_nb, stream_infos[stream_nb].bits_per_sample, stream_infos[stream_nb].nb_channels, stream->max_block_size) == -1)
+            continue;
 
-            case 12:
-                ADD_TO_VALUE(subframe, crt, 11, value);
-                crt = crt->next;
-                /* FALLTHROUGH */
+        if(init_resync_state(&stream->resync_state, data_outputs + stream_nb, stream_infos + stream_nb, stream->max_block_size, 0) == -1) {
+            free_frame_buffers(&stream->frame_info);
+            continue;
+        }
 
-            case 11:
-                ADD_TO_VALUE(subframe, crt, 10, value);
-                crt = crt->next;
-                /* FALLTHROUGH */
+        stream->is_decoding = 1;
+        ++nb_decoding_streams;
+    }
 
-            case 10:
-                ADD_TO_VALUE(subframe, crt, 9, value);
-                crt = crt->next;
-                /* FALLTHROUGH */
+    while(nb_decoding_streams > 0)
+        for(stream_nb = 0; stream_nb < nb_streams; ++stream_nb) {
+            lock_step_stream_t* stream = streams + stream_nb;
 
-            case 9:
-                ADD_TO_VALUE(subframe, crt, 8, value);
-                crt = crt->next;
-                /* FALLTHROUGH */
+            if(!stream->is_decoding)
+                continue;
 
-            case 8:
-                ADD_TO_VALUE(subframe, crt, 7, value);
-                crt = crt->next;
-                /* FALLTHROUGH */
+            if((error_code = decode_next_frame(data_inputs + stream_nb, data_outputs + stream_nb, stream_infos[stream_nb].bits_per_sample, stream->max_block_size, &stream->frame_info, &stream->resync_state)) > 0)
+                continue;
 
-            case 7:
-                ADD_TO_VALUE(subframe, crt, 6, value);
-                crt = crt->next;
-                /* FALLTHROUGH */
+            /* The end of the stream, the output limit or an error. */
+            if(error_code != -1)
+                results[stream_nb] = flush_buffer(data_outputs + stream_nb);
 
-            case 6:
-                ADD_TO_VALUE(subframe, crt, 5, value);
-                crt = crt->next;
-                /* FALLTHROUGH */
+            free_resync_state(&stream->resync_state);
+            free_frame_buffers(&stream->frame_info);
+            stream->is_decoding = 0;
+            --nb_decoding_streams;
+        }
 
-            case 5:
-                ADD_TO_VALUE(subframe, crt, 4, value);
-                crt = crt->next;
-                /* FALLTHROUGH */
+    free(streams);
 
-            case 4:
-                ADD_TO_VALUE(subframe, crt, 3, value);
-                crt = crt->next;
-                /* FALLTHROUGH */
+    for(stream_nb = 0; stream_nb < nb_streams; ++stream_nb)
+        if(results[stream_nb] == -1)
+            return -1;
 
-            case 3:
-                ADD_TO_VALUE(subframe, crt, 2, value);
-                crt = crt->next;
-                /* FALLTHROUGH */
+    return 0;
 
-            case 2:
-                ADD_TO_VALUE(subframe, crt, 1, value);
-                crt = crt->next;
-                /* FALLTHROUGH */
+}
 
-            case 1:
-                ADD_TO_VALUE(subframe, crt, 0, value);
-        }
+/**
+ * Build the index of the frames from the current position to the end of the
+ * stream without decoding them. The frames are found by looking for their
+ * sync codes and checking their headers. The input is then put back at its
+ * position.
+ *
+ * @param data_input  The stream is read from there. Should be at the first
+ *                    frame to index.
+ * @param frame_index The found frames are appended there.
+ *
+ * @return Return 0 if successful, -1 else.
+ */
+int build_frame_index(data_input_t* data_input, frame_index_t* frame_index) {
 
-        if(subframe->lpc_shift < 0)
-            value = value << (uint8_t)(-subframe->lpc_shift);
-        else {
-            if(value < 0)
-                value = -(((-value) + (dividers[subframe->lpc_shift] - 1)) >> subframe->lpc_shift);
-            else
-                value = value >> subframe->lpc_shift;
-        }
+    int error_code = 0;
+    off_t start_position = get_position(data_input);
+    off_t frame_position = start_position;
+    frame_header_t header;
 
-        value += get_next_rice_residual(data_input, &(subframe->residual_info), frame_info->block_size, order, error_code);
-        if(*error_code == -1)
-            return 0;
+    while((error_code = read_frame_bytes(data_input, &header, NULL)) == 1) {
+        frame_index_entry_t* entry = NULL;
 
-        subframe->next_out->value = value;
+        if(frame_index->nb_entries == frame_index->capacity) {
+            uint32_t capacity = (frame_index->capacity == 0) ? 1024 : frame_index->capacity * 2;
+            frame_index_entry_t* new_entries = (frame_index_entry_t*)realloc(frame_index->entries, sizeof(frame_index_entry_t) * capacity);
 
-        *error_code = put_shifted_bits(data_output, value << subframe->wasted_bits_per_sample, subframe->bits_per_sample, frame_info->channel_assignement, channel_nb);
-        if(*error_code == -1)
-            return 0;
+            if(new_entries == NULL) {
+                perror("An error occured while allocating the frame index");
+                return -1;
+            }
 
-        if(*error_code == 0) {
-            SKIP_INPUT(data_input, frame_info, subframe, channel_nb, order, crt_sample + 1, error_code);
-            return crt_sample;
+            frame_index->entries = new_entries;
+            frame_index->capacity = capacity;
         }
 
-        subframe->next_out = subframe->next_out->next;
+        entry = frame_index->entries + frame_index->nb_entries;
+        entry->offset = frame_position;
+        entry->block_size = header.block_size;
+
+        /* Frames are checked to follow each other so the fixed blocking
+           strategy ones start where the previous ones end. */
+        if(header.blocking_strategy)
+            entry->first_sample = header.number;
+        else if(frame_index->nb_entries > 0)
+            entry->first_sample = entry[-1].first_sample + entry[-1].block_size;
+        else
+            entry->first_sample = header.number * header.block_size;
+
+        ++frame_index->nb_entries;
+        frame_position = get_position(data_input);
     }
 
-    return frame_info->block_size;
+    if(error_code == -1)
+        return -1;
+
+    return skip_to_position(data_input, start_position);
 
 }
 
-#undef INIT_ONE_WARMUP
-#undef OUTPUT_ONE_WARMUP
-#undef SKIP_INPUT
-
 
 /**
- * Decode an entire frame and send the decoded samples to the output sink when
- * the output buffer is full. The decoded frame consists of a frame header and
- * one or more couple of subframe headers and data.
- *
- * @param data_input      Parameters, warm-up samples and residuals are read
- *                        from there.
- * @param data_output     The decoded samples are outputed there.
- * @param bits_per_sample Number of bits per sample coming from the stream info
- *                        block.
- * @param nb_channels     The number of channels coming from the stream info
- *                        block.
+ * Free the entries of a frame index.
  *
- * @return Return 1 if successful, 0 if the previous frame was probably the
- *         last because we hit an EOF or whatever else relevant in this case or
- *         -1 in case of an unexpected error.
+ * @param frame_index The frame index to free.
  */
-static int decode_frame(data_input_t* data_input, data_output_t* data_output, uint8_t bits_per_sample, uint8_t nb_channels) {
-
-    int error_code = 0;
-    uint8_t channel_nb = 0;
-    frame_info_t frame_info;
-    #ifdef STEREO_ONLY
-    uint16_t crt_samples[2] = {0};
-    #else
-    uint16_t crt_samples[8] = {0};
-    #endif
-    uint16_t nb_read_samples = 0;
+void free_frame_index(frame_index_t* frame_index) {
 
-    frame_info.nb_channels = nb_channels;
+    free(frame_index->entries);
+    frame_index->entries = NULL;
+    frame_index->nb_entries = 0;
+    frame_index->capacity = 0;
 
-    error_code = read_frame_header(data_input, bits_per_sample, &frame_info);
-    if(error_code == -1)
-        return -1;
-
-    if(error_code == 0)
-        return 0;
+}
 
-    #ifdef STEREO_ONLY
-    if((frame_info.channel_assignement != LEFT_RIGHT) && (frame_info.channel_assignement != LEFT_SIDE) && (frame_info.channel_assignement != RIGHT_SIDE) && (frame_info.channel_assignement != MID_SIDE)) {
-        fprintf(stderr, "Stereo only is supported\n");
-        return -1;
-    }
-    #endif
+#ifndef DISALLOW_THREADS
 
-    /* Initialize some per subframe values */
-    for(; channel_nb < nb_channels; ++channel_nb) {
-        frame_info.subframes_info[channel_nb].has_parameters = 0;
-        frame_info.subframes_info[channel_nb].data_input_position = -1;
-    }
+/**
+ * A frame handed to the decoding threads.
+ */
+typedef struct {
+    frame_bytes_t frame_bytes;  /**< The bytes of the frame. */
+    frame_info_t frame_info;    /**< The frame and its decoded samples. */
+    uint8_t is_last;            /**< Is it the last frame, which ends with the
+                                     input instead of at the next frame
+                                     header? */
+    int result;                 /**< 0 while being decoded, 1 once decoded and
+                                     -1 if the decoding failed. */
+} frame_job_t;
 
-    do {
-        int nb_bits_to_write = 0;
+/**
+ * The frames being decoded by the decoding threads. The jobs are used as a
+ * ring in stream order, the reading thread submitting the frames and then
+ * outputing them once decoded.
+ */
+typedef struct {
+    pthread_mutex_t mutex;          /**< Protect the counters, the results and
+                                         should_stop. */
+    pthread_cond_t job_submitted;   /**< Signaled when a job is submitted or
+                                         when the threads should stop. */
+    pthread_cond_t job_decoded;     /**< Signaled when a job is decoded. */
+    frame_job_t* jobs;              /**< The ring of jobs. */
+    unsigned int nb_jobs;           /**< The number of jobs of the ring. */
+    unsigned long nb_submitted_jobs;/**< The number of jobs ever submitted. */
+    unsigned long nb_taken_jobs;    /**< The number of jobs ever taken by a
+                                         decoding thread. */
+    uint8_t should_stop;            /**< Should the decoding threads stop? */
+    uint8_t bits_per_sample;        /**< The number of bits per sample of the
+                                         stream. */
+    uint16_t max_block_size;        /**< The size of each channel buffer. */
+    uint8_t crc_check;              /**< How the CRCs of the frames are
+                                         checked. */
+} frame_pool_t;
 
-        data_output->starting_position = data_output->position;
-        data_output->starting_shift = data_output->shift;
 
-        for(channel_nb = 0; channel_nb < nb_channels; ++channel_nb) {
-            /* If it is the first time decoding the subframe, we read its header. */
-            if(crt_samples[channel_nb] == 0) {
-                if(read_subframe_header(data_input, frame_info.subframes_info + channel_nb) == -1)
-                    return -1;
+/**
+ * Decode the frames submitted to the pool until told to stop.
+ *
+ * @param arg The pool.
+ *
+ * @return Return NULL.
+ */
+static void* decode_frame_jobs(void* arg) {
 
-                if((((frame_info.channel_assignement == LEFT_SIDE) || (frame_info.channel_assignement == MID_SIDE)) && (channel_nb == 1)) || ((frame_info.channel_assignement == RIGHT_SIDE) && (channel_nb == 0)))
-                    frame_info.subframes_info[channel_nb].bits_per_sample = frame_info.bits_per_sample + 1;
-                else
-                    frame_info.subframes_info[channel_nb].bits_per_sample = frame_info.bits_per_sample;
-            } else if(frame_info.subframes_info[channel_nb].type != SUBFRAME_CONSTANT) {
-                /** If it's not, we skip to the rightful position. */
-                if(skip_to_position(data_input, frame_info.subframes_info[channel_nb].data_input_position) == -1)
-                    return -1;
-                data_input->shift = frame_info.subframes_info[channel_nb].data_input_shift;
-            }
+    frame_pool_t* pool = (frame_pool_t*)arg;
 
-            /* We read the subframe data and decode them. */
-            if(frame_info.subframes_info[channel_nb].type == SUBFRAME_CONSTANT)
-                crt_samples[channel_nb] = decode_constant(data_input, data_output, &frame_info, channel_nb, crt_samples[channel_nb], &error_code);
-            else if(frame_info.subframes_info[channel_nb].type == SUBFRAME_VERBATIM)
-                crt_samples[channel_nb] = decode_verbatim(data_input, data_output, &frame_info, channel_nb, crt_samples[channel_nb], &error_code);
-            else if((SUBFRAME_FIXED_LOW <= frame_info.subframes_info[channel_nb].type) && (frame_info.subframes_info[channel_nb].type <= SUBFRAME_FIXED_HIGH))
-                crt_samples[channel_nb] = decode_fixed(data_input, data_output, &frame_info, channel_nb, crt_samples[channel_nb], &error_code);
-            else if((SUBFRAME_LPC_LOW <= frame_info.subframes_info[channel_nb].type) && (frame_info.subframes_info[channel_nb].type <= SUBFRAME_LPC_HIGH))
-                crt_samples[channel_nb] = decode_lpc(data_input, data_output, &frame_info, channel_nb, crt_samples[channel_nb], &error_code);
-            else {
-                fprintf(stderr, "Invalid subframe type\n");
-                return -1;
-            }
+    for(;;) {
+        frame_job_t* job = NULL;
+        data_input_t data_input = DATA_INPUT_INIT();
+        int result = 0;
 
-            if(error_code == -1)
-                return -1;
+        pthread_mutex_lock(&pool->mutex);
+        while(!pool->should_stop && (pool->nb_taken_jobs == pool->nb_submitted_jobs))
+            pthread_cond_wait(&pool->job_submitted, &pool->mutex);
 
-            /* We change the position in the output buffer for the next channel (if any). */
-#ifdef STEREO_ONLY
-            if(channel_nb == 0) {
-#else
-            if((channel_nb + 1) < nb_channels) {
-#endif
-                switch(frame_info.bits_per_sample) {
-#ifdef DECODE_8_BITS 
-                    case 8:
-                        data_output->position = data_output->starting_position + (channel_nb + 1);
-                        break;
-#endif
-#ifdef DECODE_12_BITS
-                    case 12:
-                        data_output->position = data_output->starting_position + (channel_nb + 1);
-                        if(data_output->shift == 4) {
-                            data_output->shift = 0;
-                            ++data_output->position;
-                        } else {
-                            data_output->shift = 4;
-                        }
-                        break;
-#endif
-#ifdef DECODE_16_BITS
-                    case 16:
-                        data_output->position = data_output->starting_position + ((channel_nb + 1) * 2);
-                        break;
-#endif
-#ifdef DECODE_20_BITS
-                    case 20:
-                        data_output->position = data_output->starting_position + ((channel_nb + 1) * 2);
-                        if(data_output->shift == 4) {
-                            data_output->shift = 0;
-                            ++data_output->position;
-                        } else {
-                            data_output->shift = 4;
-                        }
-                        break;
-#endif
-#ifdef DECODE_24_BITS
-                    case 24:
-                        data_output->position = data_output->starting_position + ((channel_nb + 1) * 3);
-                        break;
-#endif
-#ifdef DECODE_32_BITS
-                    case 32:
-                        data_output->position = data_output->starting_position + ((channel_nb + 1) * 4);
-#endif
-                }
-            }
+        if(pool->should_stop) {
+            pthread_mutex_unlock(&pool->mutex);
+            return NULL;
         }
 
-        /* Number of read samples since the last iteration (if any). */
-        nb_read_samples = crt_samples[0] - nb_read_samples;
-
-        nb_bits_to_write = nb_read_samples * nb_channels * frame_info.bits_per_sample + data_output->starting_shift;
-        dump_buffer(data_output, nb_bits_to_write);
+        job = pool->jobs + (pool->nb_taken_jobs++ % pool->nb_jobs);
+        pthread_mutex_unlock(&pool->mutex);
 
-        nb_read_samples = crt_samples[0];
-    } while(crt_samples[0] < frame_info.block_size);
+        /* The frame is decoded from its bytes as if they were a mapping. */
+        memset(job->frame_bytes.bytes + job->frame_bytes.size, 0, FRAME_BYTES_PADDING);
+        data_input.buffer = job->frame_bytes.bytes;
+        data_input.size = job->frame_bytes.size + FRAME_BYTES_PADDING;
+        data_input.read_size = data_input.size;
+        data_input.is_mapped = 1;
+        data_input.crc_check = pool->crc_check;
 
-    /** If the last subframe is a constant one and a position was saved, we skip to it. */
-    if((frame_info.subframes_info[channel_nb - 1].type == SUBFRAME_CONSTANT) && (frame_info.subframes_info[channel_nb - 1].data_input_position != -1)) {
-        if(skip_to_position(data_input, frame_info.subframes_info[channel_nb - 1].data_input_position) == -1)
-            return -1;
-        data_input->shift = frame_info.subframes_info[channel_nb - 1].data_input_shift;
-    }
+        result = decode_frame_samples(&data_input, pool->bits_per_sample, pool->max_block_size, &job->frame_info) == 1 ? 1 : -1;
 
-    /* padding */
-    if(data_input->shift != 0) {
-        data_input->shift = 0;
-        ++data_input->position;
-    }
+        /* Reading into the padding means the frame was cut short. */
+        if(data_input.position > job->frame_bytes.size) {
+            fprintf(stderr, "Unexpected end of frame.\n");
+            result = -1;
+        }
 
-    /* frame footer */
-    get_shifted_bits(data_input, 16, &error_code);
-    if(error_code == -1)
-        return -1;
+        /* Like the sequential decoding, bytes left after a frame mean a
+           damaged one unless they are a few bytes at the end. */
+        if((result == 1) && (data_input.position < job->frame_bytes.size) && (!job->is_last || ((job->frame_bytes.size - data_input.position) >= MAX_FRAME_HEADER_SIZE))) {
+            fprintf(stderr, "Something is wrong with the synchro.\n");
+            result = -1;
+        }
 
-    return 1;
+        pthread_mutex_lock(&pool->mutex);
+        job->result = result;
+        pthread_cond_broadcast(&pool->job_decoded);
+        pthread_mutex_unlock(&pool->mutex);
+    }
 
 }
 
 
 /**
- * Decode the flac metedata stream info and skip the others.
+ * Wait for a job to be decoded and output its samples.
  *
- * @param data_input  The metadata are read from there.
- * @param stream_info The resulting useful informations are put there.
+ * @param pool        The pool the job belongs to.
+ * @param job         The job to output.
+ * @param data_output The decoded samples are outputed there.
  *
- * @return Return 0 if successful, -1 else.
+ * @return Return 0 if successful, 1 if the output limit is reached or -1 if
+ *         an error occured.
  */
-int decode_flac_metadata(data_input_t* data_input, stream_info_t* stream_info) {
+static int output_frame_job(frame_pool_t* pool, frame_job_t* job, data_output_t* data_output) {
 
-    if(get_flac_stream_info(data_input, stream_info) == -1)
-        return -1;
+    int result = 0;
+
+    pthread_mutex_lock(&pool->mutex);
+    while(job->result == 0)
+        pthread_cond_wait(&pool->job_decoded, &pool->mutex);
+    result = job->result;
+    pthread_mutex_unlock(&pool->mutex);
 
-    if(skip_metadata(data_input) == -1)
+    if(result == -1)
         return -1;
 
-    return 0;
+    return output_frame(data_output, pool->max_block_size, &job->frame_info);
 
 }
 
 
 /**
- * Decode flac stream into the output sink until the end is reached.
+ * Decode flac stream into the output sink until the end is reached or the
+ * output limit, if any, is, the frames being decoded by several threads. The
+ * frames are found by looking for their headers, handed to the threads and
+ * outputed in stream order.
  *
- * @param data_input      The stream is read from there.
- * @param data_output     The decoded samples are outputed there.
- * @param bits_per_sample Number of bits per sample coming from the stream info
- *                        block.
- * @param nb_channels     The number of channels coming from the stream info
- *                        block.
+ * @param data_input  The stream is read from there.
+ * @param data_output The decoded samples are outputed there.
+ * @param stream_info The stream info of the stream. Its maximum block size sets
+ *                    the size of the per channel buffers frames are decoded
+ *                    into.
+ * @param nb_threads  The number of decoding threads.
  *
  * @return Return 0 if successful, -1 else.
  */
-int decode_flac_data(data_input_t* data_input, data_output_t* data_output, uint8_t bits_per_sample, uint8_t nb_channels) {
+int decode_flac_data_in_parallel(data_input_t* data_input, data_output_t* data_output, const stream_info_t* stream_info, uint8_t nb_threads) {
 
     int error_code = 0;
+    frame_pool_t pool;
+    frame_header_t header;
+    pthread_t* threads = NULL;
+    unsigned long nb_outputed_jobs = 0;
+    unsigned int nb_started_threads = 0;
+    unsigned int i = 0;
+    uint8_t bits_per_sample = stream_info->bits_per_sample;
+    uint8_t nb_channels = stream_info->nb_channels;
+    uint16_t max_block_size = stream_info->max_block_size;
+
+    /* A maximum block size below the minimum one allowed is not to be trusted. */
+    if(max_block_size < 16)
+        max_block_size = MAX_BLOCK_SIZE;
+
+    if(init_stream_kernels(data_output, bits_per_sample, nb_channels) == -1)
+        return -1;
+
+    /* Two jobs per thread so that threads have frames to decode while the
+       previous ones are outputed. */
+    pool.nb_jobs = 2 * nb_threads;
+    pool.nb_submitted_jobs = 0;
+    pool.nb_taken_jobs = 0;
+    pool.should_stop = 0;
+    pool.bits_per_sample = bits_per_sample;
+    pool.max_block_size = max_block_size;
+    pool.crc_check = data_input->crc_check;
+
+    pool.jobs = (frame_job_t*)calloc(pool.nb_jobs, sizeof(frame_job_t));
+    threads = (pthread_t*)malloc(sizeof(pthread_t) * nb_threads);
+    if((pool.jobs == NULL) || (threads == NULL)) {
+        perror("An error occured while allocating the decoding threads");
+        free(pool.jobs);
+        free(threads);
+        return -1;
+    }
+
+    for(; i < pool.nb_jobs; ++i)
+        if(alloc_frame_buffers(&pool.jobs[i].frame_info, data_output, bits_per_sample, nb_channels, max_block_size) == -1)
+            break;
+
+    if(i < pool.nb_jobs) {
+        while(i > 0)
+            free_frame_buffers(&pool.jobs[--i].frame_info);
+        free(pool.jobs);
+        free(threads);
+        return -1;
+    }
+
+    pthread_mutex_init(&pool.mutex, NULL);
+    pthread_cond_init(&pool.job_submitted, NULL);
+    pthread_cond_init(&pool.job_decoded, NULL);
+
+    for(; nb_started_threads < nb_threads; ++nb_started_threads)
+        if(pthread_create(threads + nb_started_threads, NULL, decode_frame_jobs, &pool) != 0) {
+            fprintf(stderr, "An error occured while starting the decoding threads\n");
+            error_code = -1;
+            break;
+        }
+
+    /* Until the end of the stream (0), the output limit (1) or an error. */
+    while(error_code == 0) {
+        frame_job_t* job = pool.jobs + (pool.nb_submitted_jobs % pool.nb_jobs);
+
+        /* Every job is in use so the oldest one is outputed first. */
+        if((pool.nb_submitted_jobs - nb_outputed_jobs) == pool.nb_jobs) {
+            error_code = output_frame_job(&pool, job, data_output);
+            ++nb_outputed_jobs;
+            continue;
+        }
+
+        error_code = read_frame_bytes(data_input, &header, &job->frame_bytes);
+        if(error_code != 1)
+            break;
+
+        /* Every frame but the last one ends where the next header starts. */
+        job->is_last = data_input->position == data_input->read_size;
+        error_code = 0;
+
+        pthread_mutex_lock(&pool.mutex);
+        job->result = 0;
+        ++pool.nb_submitted_jobs;
+        pthread_cond_signal(&pool.job_submitted);
+        pthread_mutex_unlock(&pool.mutex);
+    }
 
-    while((error_code = decode_frame(data_input, data_output, bits_per_sample, nb_channels)) > 0);
+    for(; (error_code == 0) && (nb_outputed_jobs < pool.nb_submitted_jobs); ++nb_outputed_jobs)
+        error_code = output_frame_job(&pool, pool.jobs + (nb_outputed_jobs % pool.nb_jobs), data_output);
+
+    pthread_mutex_lock(&pool.mutex);
+    pool.should_stop = 1;
+    pthread_cond_broadcast(&pool.job_submitted);
+    pthread_mutex_unlock(&pool.mutex);
+
+    for(i = 0; i < nb_started_threads; ++i)
+        pthread_join(threads[i], NULL);
+
+    pthread_cond_destroy(&pool.job_decoded);
+    pthread_cond_destroy(&pool.job_submitted);
+    pthread_mutex_destroy(&pool.mutex);
+
+    for(i = 0; i < pool.nb_jobs; ++i) {
+        free_frame_buffers(&pool.jobs[i].frame_info);
+        free(pool.jobs[i].frame_bytes.bytes);
+    }
+    free(pool.jobs);
+    free(threads);
 
     if(error_code == -1)
         return -1;
 
-    return 0;
+    return flush_buffer(data_output);
 
 }
+
+#endif
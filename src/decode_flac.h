@@ -19,20 +19,21 @@
 #endif
 
 /**
- * We define the types for decoded data.
+ * Every stream is decoded with 32 bits samples whatever its number of bits per
+ * sample. Only the side channel of a 32 bits stream needs 33 bits, it is then
+ * decoded on its own with 64 bits samples before being decorrelated.
  */
 #ifdef DECODE_32_BITS
-    #define DECODE_TYPE_64_BITS
-    #define DECODE_UTYPE uint64_t
-    #define DECODE_TYPE int64_t
-#elif defined DECODE_16_BITS || defined DECODE_20_BITS || defined DECODE_24_BITS
-    #define DECODE_TYPE_32_BITS
-    #define DECODE_UTYPE uint32_t
-    #define DECODE_TYPE int32_t
+    #define DECODE_WIDE_SIDE
+#endif
+
+/**
+ * A sample or frame number of the stream.
+ */
+#ifndef DISALLOW_64_BITS
+typedef uint64_t sample_number_t;
 #else
-    #define DECODE_TYPE_16_BITS
-    #define DECODE_UTYPE uint16_t
-    #define DECODE_TYPE int16_t
+typedef uint32_t sample_number_t;
 #endif
 
 /**
@@ -67,6 +68,17 @@
 #define RIGHT_SIDE                                                    9
 #define MID_SIDE                                                      10
 
+/**
+ * A seek point of the seek table.
+ */
+typedef struct {
+    sample_number_t sample_number;  /**< The number of the first sample of the
+                                         target frame. */
+    off_t offset;                   /**< The offset in bytes of the target
+                                         frame header from the first frame
+                                         header. */
+} seek_point_t;
+
 /**
  * Information about the flac stream.
  */
@@ -90,16 +102,22 @@ typedef struct {
                                      unknow. */
 #endif
     uint8_t md5[16];            /**< The md5 of the original pcm */
+    seek_point_t* seek_points;  /**< The seek points of the seek table sorted
+                                     by sample number, placeholders left
+                                     out. NULL if there is none. */
+    uint32_t nb_seek_points;    /**< The number of seek points. */
+    off_t first_frame_offset;   /**< The position of the first frame header in
+                                     the input stream. */
 } stream_info_t;
 
 #ifndef DISALLOW_64_BITS
-#define STREAM_INFO_INIT() {.min_block_size = 0, .max_block_size = 0, .min_frame_size = 0, .max_frame_size = 0, .sample_rate = 0, .nb_channels = 0, .bits_per_sample = 0, .nb_samples = 0, .md5 = {0}}
+#define STREAM_INFO_INIT() {.min_block_size = 0, .max_block_size = 0, .min_frame_size = 0, .max_frame_size = 0, .sample_rate = 0, .nb_channels = 0, .bits_per_sample = 0, .nb_samples = 0, .md5 = {0}, .seek_points = NULL, .nb_seek_points = 0, .first_frame_offset = 0}
 #else
-#define STREAM_INFO_INIT() {.min_block_size = 0, .max_block_size = 0, .min_frame_size = 0, .max_frame_size = 0, .sample_rate = 0, .nb_channels = 0, .bits_per_sample = 0, .md5 = {0}}
+#define STREAM_INFO_INIT() {.min_block_size = 0, .max_block_size = 0, .min_frame_size = 0, .max_frame_size = 0, .sample_rate = 0, .nb_channels = 0, .bits_per_sample = 0, .md5 = {0}, .seek_points = NULL, .nb_seek_points = 0, .first_frame_offset = 0}
 #endif
 
 /**
- * Decode the flac metedata stream info and skip the others.
+ * Decode the flac metedata stream info and seek table and skip the others.
  *
  * @param data_input  The metadata are read from there.
  * @param stream_info The resulting useful informations are put there.
@@ -109,17 +127,125 @@ typedef struct {
 int decode_flac_metadata(data_input_t* data_input, stream_info_t* stream_info);
 
 /**
- * Decode flac stream into the output sink until the end is reached.
+ * Free the seek table of the stream info.
+ *
+ * @param stream_info The stream info to free.
+ */
+void free_stream_info(stream_info_t* stream_info);
+
+/**
+ * Put the input at the frame holding a sample and set the output to drop the
+ * samples of the frame before it. The search starts from the closest seek
+ * point before the sample, or from the first frame without a seek table or if
+ * the seek point does not lead to the header of its frame, and goes on by
+ * looking for the frame headers.
+ *
+ * @param data_input    The stream is read from there.
+ * @param data_output   The decoded samples will be outputed there.
+ * @param stream_info   The stream info and seek table of the stream.
+ * @param sample_number The number of the sample to seek to.
+ * @param first_sample  The number of the first sample of the frame the input
+ *                      is put at is put there.
+ *
+ * @return Return 0 if successful, -1 else.
+ */
+int decode_flac_seek(data_input_t* data_input, data_output_t* data_output, const stream_info_t* stream_info, sample_number_t sample_number, sample_number_t* first_sample);
+
+/**
+ * Decode flac stream into the output sink until the end is reached or the
+ * output limit, if any, is. If the input asks for it, the decoding goes on
+ * after damaged frames.
+ *
+ * @param data_input   The stream is read from there.
+ * @param data_output  The decoded samples are outputed there.
+ * @param stream_info  The stream info of the stream. Its maximum block size
+ *                     sets the size of the per channel buffers frames are
+ *                     decoded into.
+ * @param first_sample The number of the first sample of the frame the input is
+ *                     at, 0 unless it was put there by decode_flac_seek.
+ *
+ * @return Return 0 if successful, -1 else.
+ */
+int decode_flac_data(data_input_t* data_input, data_output_t* data_output, const stream_info_t* stream_info, sample_number_t first_sample);
+
+/**
+ * Decode several flac streams into their own output sink, one frame of each
+ * stream in turn, until the end or the output limit, if any, of each one is
+ * reached. Decoding the streams alongside lets their outputs go on together,
+ * like their md5 hashed in lanes. A stream failing to decode is left out
+ * while the other ones go on.
  *
- * @param data_input      The stream is read from there.
- * @param data_output     The decoded samples are outputed there.
- * @param bits_per_sample Number of bits per sample coming from the stream info
- *                        block.
- * @param nb_channels     The number of channels coming from the stream info
- *                        block.
+ * @param data_inputs  The streams are read from there.
+ * @param data_outputs The decoded samples of each stream are outputed there.
+ * @param stream_infos The stream info of each stream.
+ * @param results      The result of each stream is put there, 0 if it was
+ *                     successfully decoded, -1 else.
+ * @param nb_streams   The number of streams.
+ *
+ * @return Return 0 if every stream was successfully decoded, -1 else.
+ */
+int decode_flac_data_in_lock_step(data_input_t* data_inputs, data_output_t* data_outputs, const stream_info_t* stream_infos, int* results, uint8_t nb_streams);
+
+/**
+ * Where a frame is in the input stream and which samples it holds.
+ */
+typedef struct {
+    off_t offset;                   /**< The position of the frame header in
+                                         the input stream. */
+    sample_number_t first_sample;   /**< The number of the first sample of the
+                                         frame. */
+    uint32_t block_size;            /**< The number of samples in the frame. */
+} frame_index_entry_t;
+
+/**
+ * The frames of a stream in stream order.
+ */
+typedef struct {
+    frame_index_entry_t* entries;   /**< The frames. */
+    uint32_t nb_entries;            /**< The number of frames. */
+    uint32_t capacity;              /**< The number of allocated entries. */
+} frame_index_t;
+
+#define FRAME_INDEX_INIT() {.entries = NULL, .nb_entries = 0, .capacity = 0}
+
+/**
+ * Build the index of the frames from the current position to the end of the
+ * stream without decoding them. The frames are found by looking for their
+ * sync codes and checking their headers. The input is then put back at its
+ * position.
+ *
+ * @param data_input  The stream is read from there. Should be at the first
+ *                    frame to index.
+ * @param frame_index The found frames are appended there.
+ *
+ * @return Return 0 if successful, -1 else.
+ */
+int build_frame_index(data_input_t* data_input, frame_index_t* frame_index);
+
+/**
+ * Free the entries of a frame index.
+ *
+ * @param frame_index The frame index to free.
+ */
+void free_frame_index(frame_index_t* frame_index);
+
+#ifndef DISALLOW_THREADS
+/**
+ * Decode flac stream into the output sink until the end is reached or the
+ * output limit, if any, is, the frames being decoded by several threads. The
+ * frames are found by looking for their headers, handed to the threads and
+ * outputed in stream order.
+ *
+ * @param data_input  The stream is read from there.
+ * @param data_output The decoded samples are outputed there.
+ * @param stream_info The stream info of the stream. Its maximum block size sets
+ *                    the size of the per channel buffers frames are decoded
+ *                    into.
+ * @param nb_threads  The number of decoding threads.
  *
  * @return Return 0 if successful, -1 else.
  */
-int decode_flac_data(data_input_t* data_input, data_output_t* data_output, uint8_t bits_per_sample, uint8_t nb_channels);
+int decode_flac_data_in_parallel(data_input_t* data_input, data_output_t* data_output, const stream_info_t* stream_info, uint8_t nb_threads);
+#endif
 
 #endif
@@ -17,10 +17,265 @@
 #include <string.h>
 
 #include "decode_flac.h"
+#include "seek_index.h"
 #include "input.h"
 #include "output.h"
 
 
+/**
+ * Get the name of the seek index file of a flac file.
+ *
+ * @param flac_filename The name of the flac file.
+ *
+ * @return Return the allocated name if successful, NULL else.
+ */
+static char* get_index_filename(const char* flac_filename) {
+
+    char* index_filename = (char*)malloc(strlen(flac_filename) + sizeof(SEEK_INDEX_SUFFIX));
+
+    if(index_filename == NULL) {
+        perror("An error occured while allocating the seek index filename");
+        return NULL;
+    }
+
+    strcpy(index_filename, flac_filename);
+    strcat(index_filename, SEEK_INDEX_SUFFIX);
+
+    return index_filename;
+
+}
+
+
+/**
+ * Read a number of decimal digits.
+ *
+ * @param text The digits are read from there and it is moved past them.
+ *
+ * @return Return the read number.
+ */
+static sample_number_t read_digits(const char** text) {
+
+    sample_number_t value = 0;
+
+    for(; (**text >= '0') && (**text <= '9'); ++*text)
+        value = value * 10 + (**text - '0');
+
+    return value;
+
+}
+
+
+/**
+ * Get a sample number from a position given either as a number of samples or
+ * as a timestamp like [[hours:]minutes:]seconds[.fraction] with an optional
+ * trailing s.
+ *
+ * @param text          The position.
+ * @param sample_rate   The sample rate of the stream.
+ * @param sample_number The sample number is put there.
+ *
+ * @return Return 0 if successful, -1 else.
+ */
+static int parse_sample_position(const char* text, uint32_t sample_rate, sample_number_t* sample_number) {
+
+    sample_number_t value = 0;
+    sample_number_t fraction = 0;
+    sample_number_t divisor = 1;
+    uint8_t is_timestamp = 0;
+    const char* position = text;
+
+    if((*position < '0') || (*position > '9'))
+        goto invalid;
+
+    value = read_digits(&position);
+
+    while(*position == ':') {
+        ++position;
+        if((*position < '0') || (*position > '9'))
+            goto invalid;
+
+        value = value * 60 + read_digits(&position);
+        is_timestamp = 1;
+    }
+
+    if(*position == '.') {
+        /* Digits past the nanosecond are ignored. */
+        for(++position; (*position >= '0') && (*position <= '9'); ++position)
+            if(divisor < 1000000000) {
+                fraction = fraction * 10 + (*position - '0');
+                divisor *= 10;
+            }
+
+        is_timestamp = 1;
+    }
+
+    if(*position == 's') {
+        ++position;
+        is_timestamp = 1;
+    }
+
+    if(*position != '\0')
+        goto invalid;
+
+    if(!is_timestamp) {
+        *sample_number = value;
+        return 0;
+    }
+
+    if(sample_rate == 0) {
+        fprintf(stderr, "A timestamp needs the sample rate of the stream\n");
+        return -1;
+    }
+
+    *sample_number = value * sample_rate + (fraction * sample_rate) / divisor;
+
+    return 0;
+
+invalid:
+    fprintf(stderr, "Invalid position: %s\n", text);
+    return -1;
+
+}
+
+
+/**
+ * Check the md5 of the decoded samples against the one of the stream info.
+ *
+ * @param md5_context The md5 computation of the decoded samples to end.
+ * @param stream_info The stream info holding the expected md5.
+ * @param is_quiet    Should the match not be reported?
+ *
+ * @return Return 0 if the md5 match or if the stream info has none, -1 else.
+ */
+static int verify_md5(md5_context_t* md5_context, const stream_info_t* stream_info, uint8_t is_quiet) {
+
+    uint8_t md5[16];
+    uint8_t is_md5_set = 0;
+    int i = 0;
+
+    md5_final(md5_context, md5);
+
+    for(; i < 16; ++i)
+        is_md5_set |= stream_info->md5[i];
+
+    if(!is_md5_set) {
+        fprintf(stderr, "md5 not set in the stream info, nothing to verify\n");
+        return 0;
+    }
+
+    if(memcmp(md5, stream_info->md5, 16) != 0) {
+        fprintf(stderr, "md5 mismatch: %.2x%.2x%.2x%.2x%.2x%.2x%.2x%.2x%.2x%.2x%.2x%.2x%.2x%.2x%.2x%.2x\n", md5[0], md5[1], md5[2], md5[3], md5[4], md5[5], md5[6], md5[7], md5[8], md5[9], md5[10], md5[11], md5[12], md5[13], md5[14], md5[15]);
+        return -1;
+    }
+
+    if(!is_quiet)
+        fprintf(stderr, "md5 match\n");
+
+    return 0;
+
+}
+
+
+/**
+ * Test flac files by decoding them into null outputs and verifying their md5.
+ * They are decoded in lock step by groups of MD5_MAX_LANES so that their md5
+ * are hashed in lanes. Each file is reported as ok or failed.
+ *
+ * @param flac_filenames    The names of the flac files.
+ * @param nb_files          The number of flac files.
+ * @param input_buffer_size The size of the input buffer of each file.
+ * @param is_mapped         Should the files be mapped in memory?
+ * @param crc_check         How the CRCs are checked.
+ * @param should_resync     Should the decoding go on after damaged frames?
+ * @param is_quiet          Should the files being ok not be reported?
+ *
+ * @return Return 0 if every file is ok, -1 else.
+ */
+static int test_flac_files(char* flac_filenames[], int nb_files, int input_buffer_size, uint8_t is_mapped, uint8_t crc_check, uint8_t should_resync, uint8_t is_quiet) {
+
+    int error_code = 0;
+    int file_nb = 0;
+
+    while(file_nb < nb_files) {
+        data_input_t data_inputs[MD5_MAX_LANES];
+        data_output_t data_outputs[MD5_MAX_LANES];
+        stream_info_t stream_infos[MD5_MAX_LANES];
+        md5_context_t md5_contexts[MD5_MAX_LANES];
+        md5_lanes_t md5_lanes;
+        const char* filenames[MD5_MAX_LANES];
+        int input_fds[MD5_MAX_LANES];
+        int results[MD5_MAX_LANES];
+        uint8_t nb_streams = 0;
+        uint8_t i = 0;
+
+        /* The files which cannot be opened are failed right away. */
+        for(; (file_nb < nb_files) && (nb_streams < MD5_MAX_LANES); ++file_nb) {
+            data_input_t data_input = DATA_INPUT_INIT();
+            stream_info_t stream_info = STREAM_INFO_INIT();
+            int input_fd = -1;
+
+            if((input_fd = open(flac_filenames[file_nb], O_RDONLY)) == -1) {
+                perror("An error occured while opening the flac file");
+                fprintf(stderr, "%s: failed\n", flac_filenames[file_nb]);
+                error_code = -1;
+                continue;
+            }
+
+            if(((is_mapped ? init_data_input_from_mmap(&data_input, input_fd, input_buffer_size) : init_data_input_from_fd(&data_input, input_fd, input_buffer_size)) == -1) || (decode_flac_metadata(&data_input, &stream_info) == -1)) {
+                fprintf(stderr, "%s: failed\n", flac_filenames[file_nb]);
+                free_data_input(&data_input);
+                free_stream_info(&stream_info);
+                close(input_fd);
+                error_code = -1;
+                continue;
+            }
+
+            data_input.crc_check = crc_check;
+            data_input.should_resync = should_resync;
+            data_inputs[nb_streams] = data_input;
+            stream_infos[nb_streams] = stream_info;
+            filenames[nb_streams] = flac_filenames[file_nb];
+            input_fds[nb_streams++] = input_fd;
+        }
+
+        if(nb_streams == 0)
+            continue;
+
+        if(md5_init_lanes(&md5_lanes, md5_contexts, nb_streams) == -1)
+            return -1;
+
+        for(i = 0; i < nb_streams; ++i) {
+            init_data_output_to_null(data_outputs + i);
+            data_outputs[i].md5_context = md5_contexts + i;
+        }
+
+        decode_flac_data_in_lock_step(data_inputs, data_outputs, stream_infos, results, nb_streams);
+
+        for(i = 0; i < nb_streams; ++i) {
+            if((results[i] == 0) && (data_inputs[i].read_size != data_inputs[i].position))
+                fprintf(stderr, "%s: trailing data not decoded\n", filenames[i]);
+
+            if((results[i] == 0) && (verify_md5(md5_contexts + i, stream_infos + i, 1) == 0)) {
+                if(!is_quiet)
+                    fprintf(stderr, "%s: ok\n", filenames[i]);
+            } else {
+                fprintf(stderr, "%s: failed\n", filenames[i]);
+                error_code = -1;
+            }
+
+            free_data_input(data_inputs + i);
+            free_stream_info(stream_infos + i);
+            close(input_fds[i]);
+        }
+
+        md5_free_lanes(&md5_lanes);
+    }
+
+    return error_code;
+
+}
+
+
 int main(int argc, char* argv[]) {
 
     int opt = -1;
@@ -29,6 +284,17 @@ int main(int argc, char* argv[]) {
         {"big-endian",      no_argument,       NULL, 'b'},
         {"input-size",      required_argument, NULL, 's'},
         {"max-output-size", required_argument, NULL, 'o'},
+        {"mmap",            no_argument,       NULL, 'm'},
+        {"threads",         required_argument, NULL, 't'},
+        {"write-index",     no_argument,       NULL, 'w'},
+        {"index-interval",  required_argument, NULL, 'n'},
+        {"start",           required_argument, NULL, 'S'},
+        {"crc",             required_argument, NULL, 'c'},
+        {"end",             required_argument, NULL, 'E'},
+        {"verify-md5",      no_argument,       NULL, 'v'},
+        {"test",            no_argument,       NULL, 'T'},
+        {"resync",          no_argument,       NULL, 'r'},
+        {"conceal",         required_argument, NULL, 'C'},
         {NULL,                     0,                 NULL,  0 }
     };
     data_input_t data_input = DATA_INPUT_INIT();
@@ -43,6 +309,23 @@ int main(int argc, char* argv[]) {
     uint8_t is_signed = 1;
     uint8_t can_pause = 0;
     uint8_t is_quiet = 0;
+    uint8_t is_mapped = 0;
+    int nb_threads = 1;
+    uint8_t should_write_index = 0;
+    int index_interval = 1;
+    const char* flac_filename = NULL;
+    const char* start_text = NULL;
+    const char* end_text = NULL;
+    sample_number_t start_sample = 0;
+    sample_number_t end_sample = 0;
+    sample_number_t first_sample = 0;
+    uint8_t crc_check = CRC_CHECK_WARN;
+    uint8_t is_crc_check_set = 0;
+    uint8_t should_verify_md5 = 0;
+    uint8_t is_testing = 0;
+    uint8_t should_resync = 0;
+    uint8_t concealment = CONCEAL_OFF;
+    md5_context_t md5_context;
 
     while((opt = getopt_long(argc, argv, "iq", options, NULL)) > -1)
         switch(opt) {
@@ -74,27 +357,145 @@ int main(int argc, char* argv[]) {
                 output_buffer_size = atoi(optarg);
                 break;
 
+            case 'm':
+                is_mapped = 1;
+                break;
+
+            case 't':
+                nb_threads = atoi(optarg);
+                if((nb_threads < 1) || (nb_threads > 255)) {
+                    fprintf(stderr, "The number of threads should be between 1 and 255\n");
+                    return EXIT_FAILURE;
+                }
+#ifdef DISALLOW_THREADS
+                if(nb_threads > 1) {
+                    fprintf(stderr, "Decoding with several threads is not supported\n");
+                    return EXIT_FAILURE;
+                }
+#endif
+                break;
+
+            case 'w':
+                should_write_index = 1;
+                break;
+
+            case 'n':
+                index_interval = atoi(optarg);
+                if(index_interval < 1) {
+                    fprintf(stderr, "The index interval should be at least one frame\n");
+                    return EXIT_FAILURE;
+                }
+                break;
+
+            case 'S':
+                start_text = optarg;
+                break;
+
+            case 'c':
+                if(strcmp(optarg, "off") == 0)
+                    crc_check = CRC_CHECK_OFF;
+                else if(strcmp(optarg, "warn") == 0)
+                    crc_check = CRC_CHECK_WARN;
+                else if(strcmp(optarg, "strict") == 0)
+                    crc_check = CRC_CHECK_STRICT;
+                else {
+                    fprintf(stderr, "The CRC check should be off, warn or strict\n");
+                    return EXIT_FAILURE;
+                }
+                is_crc_check_set = 1;
+                break;
+
+            case 'E':
+                end_text = optarg;
+                break;
+
+            case 'v':
+                should_verify_md5 = 1;
+                break;
+
+            case 'T':
+                is_testing = 1;
+                break;
+
+            case 'r':
+                should_resync = 1;
+                break;
+
+            case 'C':
+                if(strcmp(optarg, "silence") == 0)
+                    concealment = CONCEAL_SILENCE;
+                else if(strcmp(optarg, "repeat") == 0)
+                    concealment = CONCEAL_REPEAT;
+                else {
+                    fprintf(stderr, "The concealment should be silence or repeat\n");
+                    return EXIT_FAILURE;
+                }
+                break;
+
             case '?':
-                fprintf(stderr, "Usage: %s [-i] [-q] [--big-endian] [--unsigned] [--input-size bytes] [--max-output-size bytes] flac_file [output_filename]\n", argv[0]);
+                fprintf(stderr, "Usage: %s [-i] [-q] [--big-endian] [--unsigned] [--input-size bytes] [--max-output-size bytes] [--mmap] [--threads number] [--crc off|warn|strict] [--resync] [--conceal silence|repeat] [--start position] [--end position] [--verify-md5] [--test] [--write-index [--index-interval frames]] flac_file [output_filename | flac_file...]\n", argv[0]);
                 return EXIT_FAILURE;
         }
 
+    /* Testing is verifying without output and stopping at the first error. */
+    if(is_testing) {
+        should_verify_md5 = 1;
+        if(!is_crc_check_set)
+            crc_check = CRC_CHECK_STRICT;
+    }
+
+    /* Concealing is going on after damaged frames, with any damage counting. */
+    if(concealment != CONCEAL_OFF) {
+        should_resync = 1;
+        if(!is_crc_check_set)
+            crc_check = CRC_CHECK_STRICT;
+    }
+
+    if(should_resync && (nb_threads > 1)) {
+        fprintf(stderr, "The decoding can only be resynchronised without threads\n");
+        return EXIT_FAILURE;
+    }
+
+    if(should_verify_md5 && ((start_text != NULL) || (end_text != NULL))) {
+        fprintf(stderr, "The md5 can only be verified on the whole stream\n");
+        return EXIT_FAILURE;
+    }
+
     if(optind == argc) {
-        fprintf(stderr, "Usage: %s [-i] [-q] [--big-endian] [--unsigned] [--input-size bytes] [--max-output-size bytes] flac_file [output_filename]\n", argv[0]);
+        fprintf(stderr, "Usage: %s [-i] [-q] [--big-endian] [--unsigned] [--input-size bytes] [--max-output-size bytes] [--mmap] [--threads number] [--crc off|warn|strict] [--resync] [--conceal silence|repeat] [--start position] [--end position] [--verify-md5] [--test] [--write-index [--index-interval frames]] flac_file [output_filename | flac_file...]\n", argv[0]);
         return EXIT_FAILURE;
     }
 
-    if((input_fd = open(argv[optind++], O_RDONLY)) == -1) {
+    /* Several flac files are tested in lock step. */
+    if(is_testing && ((argc - optind) > 1)) {
+        if(nb_threads > 1) {
+            fprintf(stderr, "Several flac files can only be tested without threads\n");
+            return EXIT_FAILURE;
+        }
+
+        return test_flac_files(argv + optind, argc - optind, input_buffer_size, is_mapped, crc_check, should_resync, is_quiet) == -1 ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    flac_filename = argv[optind++];
+    if((input_fd = open(flac_filename, O_RDONLY)) == -1) {
         perror("An error occured while opening the flac file");
         return EXIT_FAILURE;
     }
 
-    if(init_data_input_from_fd(&data_input, input_fd, input_buffer_size) == -1)
-        return EXIT_FAILURE;
+    if(is_mapped) {
+        if(init_data_input_from_mmap(&data_input, input_fd, input_buffer_size) == -1)
+            return EXIT_FAILURE;
+    } else {
+        if(init_data_input_from_fd(&data_input, input_fd, input_buffer_size) == -1)
+            return EXIT_FAILURE;
+    }
 
     if(decode_flac_metadata(&data_input, &stream_info) == -1)
         return EXIT_FAILURE;
 
+    data_input.crc_check = crc_check;
+    data_input.should_resync = should_resync;
+
     if(!is_quiet) {
         fprintf(stderr, "min_block_size: %u\n", stream_info.min_block_size);
         fprintf(stderr, "max_block_size: %u\n", stream_info.max_block_size);
@@ -108,6 +509,37 @@ int main(int argc, char* argv[]) {
 #endif
     }
 
+    if(should_write_index) {
+        frame_index_t frame_index = FRAME_INDEX_INIT();
+        char* index_filename = NULL;
+        struct stat flac_stat;
+
+        if(fstat(input_fd, &flac_stat) == -1) {
+            perror("An error occured while getting the size of the flac file");
+            return EXIT_FAILURE;
+        }
+
+        if((index_filename = get_index_filename(flac_filename)) == NULL)
+            return EXIT_FAILURE;
+
+        if(build_frame_index(&data_input, &frame_index) == -1)
+            return EXIT_FAILURE;
+
+        if(save_seek_index(index_filename, &stream_info, &frame_index, flac_stat.st_size, index_interval) == -1)
+            return EXIT_FAILURE;
+
+        if(!is_quiet)
+            fprintf(stderr, "%u frames indexed into %s\n", frame_index.nb_entries, index_filename);
+
+        free(index_filename);
+        free_frame_index(&frame_index);
+        free_data_input(&data_input);
+        free_stream_info(&stream_info);
+        close(input_fd);
+
+        return EXIT_SUCCESS;
+    }
+
 #ifndef DECODE_8_BITS
     if(stream_info.bits_per_sample == 8) {
         fprintf(stderr, "bits per sample not supported: 8 bits\n");
@@ -155,35 +587,105 @@ int main(int argc, char* argv[]) {
         return EXIT_FAILURE;
     }
 
-    if((optind == argc) || (strcmp(argv[optind], "-") == 0)) {
-        output_fd = 1;
-    } else {
-        if((output_fd = open(argv[optind], O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR)) == -1) {
-            perror("An error occured while opening the output_file");
+    if(is_testing) {
+        if(init_data_output_to_null(&data_output) == -1)
             return EXIT_FAILURE;
+    } else {
+        if((optind == argc) || (strcmp(argv[optind], "-") == 0)) {
+            output_fd = 1;
+        } else {
+            if((output_fd = open(argv[optind], O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR)) == -1) {
+                perror("An error occured while opening the output_file");
+                return EXIT_FAILURE;
+            }
         }
+
+        output_buffer_size = (output_buffer_size / (stream_info.bits_per_sample * stream_info.nb_channels)) * stream_info.bits_per_sample * stream_info.nb_channels;
+
+        if(init_data_output_to_fd(&data_output, output_fd, output_buffer_size, is_little_endian, is_signed, can_pause) == -1)
+            return EXIT_FAILURE;
     }
 
-    output_buffer_size = (output_buffer_size / (stream_info.bits_per_sample * stream_info.nb_channels)) * stream_info.bits_per_sample * stream_info.nb_channels;
+    data_output.concealment = concealment;
 
-    if(init_data_output_to_fd(&data_output, output_fd, output_buffer_size, is_little_endian, is_signed, can_pause) == -1)
+    if(should_verify_md5) {
+        md5_init(&md5_context);
+        data_output.md5_context = &md5_context;
+    }
+
+    if((start_text != NULL) && (parse_sample_position(start_text, stream_info.sample_rate, &start_sample) == -1))
         return EXIT_FAILURE;
 
+    if(end_text != NULL) {
+        if(parse_sample_position(end_text, stream_info.sample_rate, &end_sample) == -1)
+            return EXIT_FAILURE;
+
+        if(end_sample <= start_sample) {
+            fprintf(stderr, "The end should be after the start\n");
+            return EXIT_FAILURE;
+        }
+
+        data_output.nb_samples_to_output = end_sample - start_sample;
+        data_output.is_limited = 1;
+    }
+
+    if(start_sample > 0) {
+        /* Without a seek table, a seek index file might help. */
+        if(stream_info.nb_seek_points == 0) {
+            char* index_filename = NULL;
+            struct stat flac_stat;
+
+            if(fstat(input_fd, &flac_stat) == -1) {
+                perror("An error occured while getting the size of the flac file");
+                return EXIT_FAILURE;
+            }
+
+            if((index_filename = get_index_filename(flac_filename)) == NULL)
+                return EXIT_FAILURE;
+
+            if(load_seek_index(index_filename, &stream_info, flac_stat.st_size) == -1)
+                return EXIT_FAILURE;
 
-    if(decode_flac_data(&data_input, &data_output, stream_info.bits_per_sample, stream_info.nb_channels) == -1)
+            free(index_filename);
+        }
+
+        if(decode_flac_seek(&data_input, &data_output, &stream_info, start_sample, &first_sample) == -1)
+            return EXIT_FAILURE;
+    }
+
+
+#ifndef DISALLOW_THREADS
+    if(nb_threads > 1) {
+        if(decode_flac_data_in_parallel(&data_input, &data_output, &stream_info, nb_threads) == -1)
+            return EXIT_FAILURE;
+    } else
+#endif
+    if(decode_flac_data(&data_input, &data_output, &stream_info, first_sample) == -1)
         return EXIT_FAILURE;
 
-    if ( data_input.read_size != data_input.position)
+    if (!data_output.is_limited && (data_input.read_size != data_input.position))
         fprintf(stderr, "trailing data not decoded\n");
 
     if(!is_quiet)
         fprintf(stderr, "header md5: %.2x%.2x%.2x%.2x%.2x%.2x%.2x%.2x%.2x%.2x%.2x%.2x%.2x%.2x%.2x%.2x\n", stream_info.md5[0], stream_info.md5[1], stream_info.md5[2], stream_info.md5[3], stream_info.md5[4], stream_info.md5[5], stream_info.md5[6], stream_info.md5[7], stream_info.md5[8], stream_info.md5[9], stream_info.md5[10], stream_info.md5[11], stream_info.md5[12], stream_info.md5[13], stream_info.md5[14], stream_info.md5[15]);
 
-    free(data_input.buffer);
+    if(should_verify_md5 && (verify_md5(&md5_context, &stream_info, is_quiet) == -1)) {
+        free_data_input(&data_input);
+        free_stream_info(&stream_info);
+        free(data_output.buffer);
+        close(input_fd);
+        if(output_fd != -1)
+            close(output_fd);
+        return EXIT_FAILURE;
+    }
+
+    free_data_input(&data_input);
+    free_stream_info(&stream_info);
     free(data_output.buffer);
 
     close(input_fd);
-    close(output_fd);
+    if(output_fd != -1)
+        close(output_fd);
 
     return EXIT_SUCCESS;
 
@@ -82,7 +82,8 @@ int main(int argc, char* argv[]) {
 
     printf("%s", output_buffer);
 
-    free(data_input.buffer);
+    free_data_input(&data_input);
+    free_stream_info(&stream_info);
     close(input_fd);
 
     return EXIT_SUCCESS;
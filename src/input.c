@@ -5,10 +5,14 @@
  * as published by Sam Hocevar. See the COPYING file for more details.
  */
 
+#define _POSIX_C_SOURCE 200112L
 #include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <limits.h>
 #include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 #include <unistd.h>
 #include <string.h>
 
@@ -30,16 +34,25 @@ int init_data_input_from_fd(data_input_t* data_input, int fd, int buffer_size) {
 
     data_input->fd = fd;
 
+    /* The input might not be seekable (a pipe for example), we then start counting from 0. */
+    data_input->offset = lseek(fd, 0, SEEK_CUR);
+    if(data_input->offset == -1)
+        data_input->offset = 0;
+
     data_input->size = buffer_size;
-    data_input->buffer = (uint8_t*)malloc(sizeof(uint8_t) * data_input->size);
+    data_input->buffer = (uint8_t*)malloc(sizeof(uint8_t) * (data_input->size + INPUT_BUFFER_PADDING));
     if(data_input->buffer == NULL) {
         perror("An error occured while allocating the input buffer");
         return -1;
     }
+    memset(data_input->buffer + data_input->size, 0, INPUT_BUFFER_PADDING);
 
+    /* The buffer is considered fully consumed, the refill will move the offset forward. */
+    data_input->offset -= data_input->size;
     data_input->read_size = data_input->size;
     data_input->position = data_input->size;
     data_input->shift = 0;
+    data_input->is_mapped = 0;
 
     if(refill_input_buffer(data_input) != 1)
         return -1;
@@ -49,6 +62,83 @@ int init_data_input_from_fd(data_input_t* data_input, int fd, int buffer_size) {
 }
 
 
+/**
+ * Init the input from a memory mapping of the whole file behind a file
+ * descriptor. The mapping is then used as the input buffer and is never
+ * refilled. A file too big for the positions in the buffer is read through an
+ * input buffer instead.
+ *
+ * @param data_input  The structure representing the input to fill out.
+ * @param fd          The input file descriptor. Should be a regular file.
+ * @param buffer_size The size of the input buffer if the file is too big to be
+ *                    mapped.
+ *
+ * @return Return 0 if successful, -1 else.
+ */
+int init_data_input_from_mmap(data_input_t* data_input, int fd, int buffer_size) {
+
+    struct stat file_stat;
+    void* mapping = NULL;
+
+    if(fd < 0)
+        return -1;
+
+    if(fstat(fd, &file_stat) == -1) {
+        perror("An error occured while mapping the input");
+        return -1;
+    }
+
+    if(!S_ISREG(file_stat.st_mode) || (file_stat.st_size < 42)) {
+        fprintf(stderr, "Only regular files of at least 42 bytes can be mapped\n");
+        return -1;
+    }
+
+    /* The positions in the buffer are ints. */
+    if(file_stat.st_size > INT_MAX - (off_t)INPUT_BUFFER_PADDING) {
+        fprintf(stderr, "The input is too big to be mapped, it is read instead\n");
+        return init_data_input_from_fd(data_input, fd, buffer_size);
+    }
+
+    mapping = mmap(NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(mapping == MAP_FAILED) {
+        perror("An error occured while mapping the input");
+        return -1;
+    }
+
+    /* Only a hint, we do not care if it fails. */
+    posix_madvise(mapping, file_stat.st_size, POSIX_MADV_SEQUENTIAL);
+
+    data_input->fd = fd;
+    data_input->buffer = (uint8_t*)mapping;
+    data_input->offset = 0;
+    data_input->size = file_stat.st_size;
+    data_input->read_size = file_stat.st_size;
+    data_input->position = 0;
+    data_input->shift = 0;
+    data_input->is_mapped = 1;
+
+    return 0;
+
+}
+
+
+/**
+ * Free the input buffer or unmap it if the input was memory mapped.
+ *
+ * @param data_input The input to free.
+ */
+void free_data_input(data_input_t* data_input) {
+
+    if(data_input->is_mapped)
+        munmap(data_input->buffer, data_input->size);
+    else
+        free(data_input->buffer);
+
+    data_input->buffer = NULL;
+
+}
+
+
 /**
  * Skip to a saved position in the input stream.
  *
@@ -57,15 +147,25 @@ int init_data_input_from_fd(data_input_t* data_input, int fd, int buffer_size) {
  *
  * @return Return -1 if an error occurred, 0 else.
  */
-int skip_to_position(data_input_t* data_input, int position) {
-    off_t crt_position = lseek(data_input->fd, 0, SEEK_CUR);
-    if(position == -1) {
-        perror("Error while skipping to position");
+int skip_to_position(data_input_t* data_input, off_t position) {
+
+    if(position < 0) {
+        fprintf(stderr, "Error while skipping to position\n");
         return -1;
     }
 
-    if((position >= (crt_position - data_input->read_size)) && (position < crt_position)) {
-        data_input->position = data_input->read_size - (crt_position - position);
+    if((position >= data_input->offset) && ((position - data_input->offset) < data_input->read_size)) {
+        data_input->position = position - data_input->offset;
+        return 0;
+    }
+
+    if(data_input->is_mapped) {
+        if(position != data_input->read_size) {
+            fprintf(stderr, "Error while skipping to position\n");
+            return -1;
+        }
+
+        data_input->position = position;
         return 0;
     }
 
@@ -74,6 +174,7 @@ int skip_to_position(data_input_t* data_input, int position) {
         return -1;
     }
 
+    data_input->offset = position - data_input->size;
     data_input->read_size = data_input->size;
     data_input->position = data_input->size;
     data_input->shift = 0;
@@ -95,6 +196,7 @@ int skip_nb_bits(data_input_t* data_input, int nb_bits_to_skip) {
 
     int nb_bytes_to_skip = (nb_bits_to_skip >> 3) + ((data_input->shift + (nb_bits_to_skip & 7)) >> 3);
     uint8_t new_shift = (data_input->shift + (nb_bits_to_skip & 7)) & 7;
+    off_t new_position = data_input->offset + data_input->position + nb_bytes_to_skip;
 
     if((data_input->position + nb_bytes_to_skip) < data_input->read_size) {
         data_input->position += nb_bytes_to_skip;
@@ -102,11 +204,23 @@ int skip_nb_bits(data_input_t* data_input, int nb_bits_to_skip) {
         return 0;
     }
 
-    if(lseek(data_input->fd, nb_bytes_to_skip - (data_input->read_size - data_input->position), SEEK_CUR) == -1) {
+    if(data_input->is_mapped) {
+        if((data_input->position + nb_bytes_to_skip) > data_input->read_size) {
+            fprintf(stderr, "Error while skipping to position\n");
+            return -1;
+        }
+
+        data_input->position += nb_bytes_to_skip;
+        data_input->shift = new_shift;
+        return 0;
+    }
+
+    if(lseek(data_input->fd, new_position, SEEK_SET) == -1) {
         perror("Error while skipping to position");
         return -1;
     }
 
+    data_input->offset = new_position - data_input->size;
     data_input->read_size = data_input->size;
     data_input->position = data_input->size;
     data_input->shift = 0;
@@ -149,7 +263,8 @@ int refill_input_buffer_at_least(data_input_t* data_input, int nb_needed_bytes)
 
 /**
  * Try to refill the input buffer from the last position while preserving any
- * unused bytes in the input buffer.
+ * unused bytes in the input buffer. If the CRCs are checked, the consumed
+ * bytes of the current frame are added to its CRC-16 before being dropped.
  *
  * @param data_input Contain the input buffer and the necessary information to
  *                   refill it.
@@ -165,6 +280,18 @@ int refill_input_buffer(data_input_t* data_input) {
     /* Try to read by the biggest chunk possible (might be silly though) */
     int nb_bytes_to_read = data_input->position;
 
+    /* The whole file is already there. */
+    if(data_input->is_mapped)
+        return 0;
+
+    /* The consumed bytes of the frame are about to be dropped. */
+    if(data_input->crc_check != CRC_CHECK_OFF) {
+        update_frame_crc16(data_input);
+        data_input->crc_position = 0;
+    }
+
+    data_input->offset += data_input->position;
+
     if(data_input->position > 0) {
         if(data_input->position < (data_input->read_size >> 1))
             memmove(data_input->buffer, data_input->buffer + data_input->position, total_nb_read_bytes);
@@ -198,6 +325,63 @@ int refill_input_buffer(data_input_t* data_input) {
 }
 
 
+/**
+ * Load a big endian word from the input buffer. The bytes past the end of the
+ * read data are the buffer padding and are masked off by the callers.
+ *
+ * @param bytes Where to load the word from.
+ *
+ * @return Return the loaded word.
+ */
+static inline input_word_t load_big_endian_word(const uint8_t* bytes) {
+
+    input_word_t word = 0;
+
+#if defined __GNUC__ && defined __BYTE_ORDER__ && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+    memcpy(&word, bytes, sizeof(input_word_t));
+    #ifdef DISALLOW_64_BITS
+    return __builtin_bswap32(word);
+    #else
+    return __builtin_bswap64(word);
+    #endif
+#elif defined __GNUC__ && defined __BYTE_ORDER__ && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    memcpy(&word, bytes, sizeof(input_word_t));
+    return word;
+#else
+    unsigned int i = 0;
+
+    for(; i < sizeof(input_word_t); ++i)
+        word = (word << 8) | bytes[i];
+
+    return word;
+#endif
+
+}
+
+
+/**
+ * Load a big endian word from the nb_bytes last bytes of a buffer which
+ * cannot be read past its end (a memory mapping for example). The missing
+ * bytes are replaced by zeros.
+ *
+ * @param bytes    Where to load the word from.
+ * @param nb_bytes The number of bytes left in the buffer.
+ *
+ * @return Return the loaded word.
+ */
+static input_word_t load_partial_big_endian_word(const uint8_t* bytes, int nb_bytes) {
+
+    input_word_t word = 0;
+    int i = 0;
+
+    for(; i < (int)sizeof(input_word_t); ++i)
+        word = (word << 8) | (i < nb_bytes ? bytes[i] : 0);
+
+    return word;
+
+}
+
+
 /**
  * Return one shifted bit from the input stream. Useful for rice coding and
  * subframe header decoding
@@ -209,32 +393,114 @@ int refill_input_buffer(data_input_t* data_input) {
  */
 uint8_t get_one_shifted_bit(data_input_t* data_input, int* error_code) {
 
+    uint8_t bit = 0;
+
     if(data_input->position == data_input->read_size)
         if(refill_input_buffer(data_input) != 1) {
             *error_code = -1;
             return 1;   // We return 1 to exit loops.
         }
 
-    ++data_input->shift;
-    switch(data_input->shift) {
-        case 1:
-            return data_input->buffer[data_input->position] >> 7;
-        case 2:
-            return (data_input->buffer[data_input->position] >> 6) & 0x01;
-        case 3:
-            return (data_input->buffer[data_input->position] >> 5) & 0x01;
-        case 4:
-            return (data_input->buffer[data_input->position] >> 4) & 0x01;
-        case 5:
-            return (data_input->buffer[data_input->position] >> 3) & 0x01;
-        case 6:
-            return (data_input->buffer[data_input->position] >> 2) & 0x01;
-        case 7:
-            return (data_input->buffer[data_input->position] >> 1) & 0x01;
+    bit = (data_input->buffer[data_input->position] >> (7 - data_input->shift)) & 0x01;
+
+    if(++data_input->shift == 8) {
+        data_input->shift = 0;
+        ++data_input->position;
     }
 
-    data_input->shift = 0;
-    return data_input->buffer[data_input->position++] & 0x01;
+    return bit;
+
+}
+
+
+/**
+ * Count the leading zeros of a non null word.
+ *
+ * @param word The word, should not be 0.
+ *
+ * @return Return the number of leading zeros.
+ */
+static inline uint8_t count_leading_zeros(input_word_t word) {
+
+#if defined __GNUC__ && defined DISALLOW_64_BITS
+    return __builtin_clzl(word) - ((sizeof(unsigned long) - sizeof(input_word_t)) * 8);
+#elif defined __GNUC__
+    return __builtin_clzll(word) - ((sizeof(unsigned long long) - sizeof(input_word_t)) * 8);
+#else
+    uint8_t nb_zeros = 0;
+
+    while(!(word & (((input_word_t)1) << ((sizeof(input_word_t) * 8) - 1)))) {
+        word <<= 1;
+        ++nb_zeros;
+    }
+
+    return nb_zeros;
+#endif
+
+}
+
+
+/**
+ * Read a unary coded value, that is a run of zero bits ended by a one bit, and
+ * return the number of zero bits. The whole run inside a loaded word is
+ * consumed at once.
+ *
+ * @param data_input     Bits and bytes are read from there.
+ * @param error_code     If any error occurs, it will be equal to -1.
+ *
+ * @return Return the number of zero bits before the one bit.
+ */
+uint32_t get_unary_value(data_input_t* data_input, int* error_code) {
+
+    uint32_t nb_zeros = 0;
+
+    for(;;) {
+        input_word_t word = 0;
+        int nb_available_bytes = data_input->read_size - data_input->position;
+        int nb_word_bytes = sizeof(input_word_t);
+        uint8_t nb_leading_zeros = 0;
+
+        if(nb_available_bytes < nb_word_bytes) {
+            if(nb_available_bytes == 0) {
+                if(refill_input_buffer(data_input) != 1) {
+                    *error_code = -1;
+                    return nb_zeros;
+                }
+                nb_available_bytes = data_input->read_size - data_input->position;
+            }
+
+            if(nb_available_bytes < nb_word_bytes) {
+                nb_word_bytes = nb_available_bytes;
+                /* A mapping has no padding so we must not read past its end. */
+                if(data_input->is_mapped)
+                    word = load_partial_big_endian_word(data_input->buffer + data_input->position, nb_available_bytes);
+                else
+                    word = load_big_endian_word(data_input->buffer + data_input->position) & ~((~(input_word_t)0) >> (nb_available_bytes * 8));
+            } else {
+                word = load_big_endian_word(data_input->buffer + data_input->position);
+            }
+        } else {
+            word = load_big_endian_word(data_input->buffer + data_input->position);
+        }
+
+        word <<= data_input->shift;
+
+        if(word != 0) {
+            uint8_t nb_consumed_bits = 0;
+
+            nb_leading_zeros = count_leading_zeros(word);
+            nb_consumed_bits = data_input->shift + nb_leading_zeros + 1;
+            data_input->position += nb_consumed_bits >> 3;
+            data_input->shift = nb_consumed_bits & 7;
+
+            return nb_zeros + nb_leading_zeros;
+        }
+
+        /* Only zeros, we go to the next word. */
+        nb_zeros += (nb_word_bytes * 8) - data_input->shift;
+        data_input->position += nb_word_bytes;
+        data_input->shift = 0;
+    }
 
 }
 
@@ -250,212 +516,136 @@ uint8_t get_one_shifted_bit(data_input_t* data_input, int* error_code) {
  */
 #ifdef DISALLOW_64_BITS
 uint32_t get_shifted_bits(data_input_t* data_input, uint8_t requested_size, int* error_code) {
-
-    uint32_t value = 0;
 #else
 uint64_t get_shifted_bits(data_input_t* data_input, uint8_t requested_size, int* error_code) {
-
-    uint64_t value = 0;
 #endif
 
-    uint8_t nb_needed_bits = (requested_size + data_input->shift);
-    uint8_t nb_needed_bytes = nb_needed_bits >> 3;
-    uint8_t* buffer = NULL;
-    int position = 0;
-    uint8_t shift = 0;
+    input_word_t word = 0;
+    uint8_t nb_consumed_bits = 0;
+    int nb_available_bytes = data_input->read_size - data_input->position;
 
     *error_code = 0;
 
-    if((data_input->shift != 0) || (nb_needed_bits & 7) != 0)
-        ++nb_needed_bytes;
-
-    if((data_input->read_size - data_input->position) < nb_needed_bytes) {
-        *error_code = refill_input_buffer(data_input);
+    if(requested_size == 0)
+        return 0;
 
-        if(*error_code == -1)
-            return 0;
+    /* A word cannot hold the requested bits once shifted so we read them in two steps. */
+    if(requested_size > INPUT_WORD_MAX_READ_SIZE) {
+        input_word_t value = 0;
 
-        if((*error_code == 0) || ((data_input->read_size - data_input->position) < nb_needed_bytes)) {
-            fprintf(stderr, "2: Unexpected end of file.\n");
+        if(requested_size > (sizeof(input_word_t) * 8)) {
             *error_code = -1;
             return 0;
         }
+
+        value = get_shifted_bits(data_input, requested_size - 16, error_code);
+        if(*error_code == -1)
+            return 0;
+
+        return (value << 16) | get_shifted_bits(data_input, 16, error_code);
     }
 
-    buffer = data_input->buffer;
-    position = data_input->position;
-    shift = data_input->shift;
-
-    if((shift == 0) && ((requested_size & 7) == 0)) {
-        switch(requested_size) {
-            case 8:
-                return buffer[data_input->position++];
-                
-            case 16:
-                value = (buffer[position] << 8) | buffer[position + 1];
-                data_input->position += 2;
-                return value;
-
-            case 24:
-                value = (buffer[position] << 16) | (buffer[position + 1] << 8) | buffer[position + 2];
-                data_input->position += 3;
-                return value;
-
-            case 32:
-                value = (buffer[position] << 24) | (buffer[position + 1] << 16) | (buffer[position + 2] << 8) | buffer[position + 3];
-                data_input->position += 4;
-                return value;
-
-#ifndef DISALLOW_64_BITS
-            case 40:
-                value = ((uint64_t)buffer[position] << 32) | (buffer[position + 1] << 24) | (buffer[position + 2] << 16) | (buffer[position + 3] << 8) | buffer[position + 4];
-                data_input->position += 5;
-                return value;
-
-            case 48:
-                value = ((uint64_t)buffer[position] << 40) | ((uint64_t)buffer[position + 1] << 32) | (buffer[position + 2] << 24) | (buffer[position + 3] << 16) | (buffer[position + 4] << 8) | buffer[position + 5];
-                data_input->position += 6;
-                return value;
-
-            case 56:
-                value = ((uint64_t)buffer[position] << 48) | ((uint64_t)buffer[position + 1] << 40) | ((uint64_t)buffer[position + 2] << 32) | (buffer[position + 3] << 24) | (buffer[position + 4] << 16) | (buffer[position + 5] << 8) | buffer[position + 6];
-                data_input->position += 7;
-                return value;
-
-            case 64:
-                value = ((uint64_t)buffer[position] << 56) | ((uint64_t)buffer[position + 1] << 48) | ((uint64_t)buffer[position + 2] << 40) | ((uint64_t)buffer[position + 3] << 32) | (buffer[position + 4] << 24) | (buffer[position + 5] << 16) | (buffer[position + 6] << 8) | buffer[position + 7];
-                data_input->position += 8;
-                return value;
-#endif
+    if(nb_available_bytes < (int)sizeof(input_word_t)) {
+        int nb_needed_bytes = (data_input->shift + requested_size + 7) >> 3;
 
-            default:
-            *error_code = -1;
+        if(nb_available_bytes < nb_needed_bytes) {
+            *error_code = refill_input_buffer(data_input);
+
+            if(*error_code == -1)
+                return 0;
+
+            nb_available_bytes = data_input->read_size - data_input->position;
+            if((*error_code == 0) || (nb_available_bytes < nb_needed_bytes)) {
+                fprintf(stderr, "2: Unexpected end of file.\n");
+                *error_code = -1;
+                return 0;
+            }
+
+            *error_code = 0;
         }
 
-        return value;
+        /* A mapping has no padding so we must not read past its end. */
+        if(data_input->is_mapped && (nb_available_bytes < (int)sizeof(input_word_t)))
+            word = load_partial_big_endian_word(data_input->buffer + data_input->position, nb_available_bytes);
+        else
+            word = load_big_endian_word(data_input->buffer + data_input->position);
+    } else {
+        word = load_big_endian_word(data_input->buffer + data_input->position);
     }
 
-    switch(nb_needed_bits) {
-        case 1:
-        case 2:
-        case 3:
-        case 4:
-        case 5:
-        case 6:
-        case 7:
-            value = ((buffer[position] & (0xFF >> shift)) >> (8 - nb_needed_bits));
-            data_input->shift += requested_size;
-            return value;
-
-        case 8:
-        case 9:
-        case 10:
-        case 11:
-        case 12:
-        case 13:
-        case 14:
-        case 15:
-            value = ((buffer[position] & (0xFF >> shift)) << (nb_needed_bits - 8)) | (buffer[position + 1] >> (16 - nb_needed_bits));
-            data_input->position +=1;
-            data_input->shift = nb_needed_bits - 8;
-            return value;
-
-        case 16:
-        case 17:
-        case 18:
-        case 19:
-        case 20:
-        case 21:
-        case 22:
-        case 23:
-            value = ((buffer[position] & (0xFF >> shift)) << (nb_needed_bits - 8)) | (buffer[position + 1] << (nb_needed_bits - 16)) | (buffer[position + 2] >> (24 - nb_needed_bits));
-            data_input->position += 2;
-            data_input->shift = nb_needed_bits - 16;
-            return value;
-        case 24:
-        case 25:
-        case 26:
-        case 27:
-        case 28:
-        case 29:
-        case 30:
-        case 31:
-            value = ((buffer[position] & (0xFF >> shift)) << (nb_needed_bits - 8)) | (buffer[position + 1] << (nb_needed_bits - 16)) | (buffer[position + 2] << (nb_needed_bits - 24)) | (buffer[position + 3] >> (32 - nb_needed_bits));
-            data_input->position += 3;
-            data_input->shift = nb_needed_bits - 24;
-            return value;
-
-#ifndef DISALLOW_64_BITS
-        case 32:
-        case 33:
-        case 34:
-        case 35:
-        case 36:
-        case 37:
-        case 38:
-        case 39:
-            value = ((uint64_t)(buffer[position] & (0xFF >> shift)) << (nb_needed_bits - 8)) | (buffer[position + 1] << (nb_needed_bits - 16)) | (buffer[position + 2] << (nb_needed_bits - 24)) | (buffer[position + 3] << (nb_needed_bits - 32)) | (buffer[position + 4] >> (40 - nb_needed_bits));
-            data_input->position += 4;
-            data_input->shift = nb_needed_bits - 32;
-            return value;
-
-        case 40:
-        case 41:
-        case 42:
-        case 43:
-        case 44:
-        case 45:
-        case 46:
-        case 47:
-            value = ((uint64_t)(buffer[position] & (0xFF >> shift)) << (nb_needed_bits - 8)) | ((uint64_t)buffer[position + 1] << (nb_needed_bits - 16)) | (buffer[position + 2] << (nb_needed_bits - 24)) | (buffer[position + 3] << (nb_needed_bits - 32)) | (buffer[position + 4] << (nb_needed_bits - 40)) | (buffer[position + 5] >> (48 - nb_needed_bits));
-            data_input->position += 5;
-            data_input->shift = nb_needed_bits - 40;
-            return value;
-
-        case 48:
-        case 49:
-        case 50:
-        case 51:
-        case 52:
-        case 53:
-        case 54:
-        case 55:
-            value = ((uint64_t)(buffer[position] & (0xFF >> shift)) << (nb_needed_bits - 8)) | ((uint64_t)buffer[position + 1] << (nb_needed_bits - 16)) | ((uint64_t)buffer[position + 2] << (nb_needed_bits - 24)) | (buffer[position + 3] << (nb_needed_bits - 32)) | (buffer[position + 4] << (nb_needed_bits - 40)) | (buffer[position + 5] << (nb_needed_bits - 48)) | (buffer[position + 6] >> (56 - nb_needed_bits));
-            data_input->position += 6;
-            data_input->shift = nb_needed_bits - 48;
-            return value;
-
-        case 56:
-        case 57:
-        case 58:
-        case 59:
-        case 60:
-        case 61:
-        case 62:
-        case 63:
-            value = ((uint64_t)(buffer[position] & (0xFF >> shift))  << (nb_needed_bits - 8)) | ((uint64_t)buffer[position + 1] << (nb_needed_bits - 16)) | ((uint64_t)buffer[position + 2] << (nb_needed_bits - 24)) | ((uint64_t)buffer[position + 3] << (nb_needed_bits - 32)) | (buffer[position + 4] << (nb_needed_bits - 40)) | (buffer[position + 5] << (nb_needed_bits - 48)) | (buffer[position + 6] << (nb_needed_bits - 56)) | (buffer[position + 7] >> (64 - nb_needed_bits));
-            data_input->position += 7;
-            data_input->shift = nb_needed_bits - 56;
-            return value;
-
-        case 64:
-        case 65:
-        case 66:
-        case 67:
-        case 68:
-        case 69:
-        case 70:
-        case 71:
-            value = ((uint64_t)(buffer[position] & (0xFF >> shift))  << (nb_needed_bits - 8)) | ((uint64_t)buffer[position + 1] << (nb_needed_bits - 16)) | ((uint64_t)buffer[position + 2] << (nb_needed_bits - 24)) | ((uint64_t)buffer[position + 3] << (nb_needed_bits - 32)) | (buffer[position + 4] << (nb_needed_bits - 40)) | (buffer[position + 5] << (nb_needed_bits - 48)) | (buffer[position + 6] << (nb_needed_bits - 56)) | (buffer[position + 7] << (nb_needed_bits - 64)) | (buffer[position + 8] >> (72 - nb_needed_bits));
-            data_input->position += 8;
-            data_input->shift = nb_needed_bits - 64;
-            return value;
-#endif
+    nb_consumed_bits = data_input->shift + requested_size;
+    data_input->position += nb_consumed_bits >> 3;
+    data_input->shift = nb_consumed_bits & 7;
+
+    return (word << (nb_consumed_bits - requested_size)) >> ((sizeof(input_word_t) * 8) - requested_size);
+
+}
 
-        default:
-        *error_code = -1;
+
+/**
+ * Read a run of rice coded signed values sharing the same rice parameter. As
+ * long as a whole word can be loaded from the buffer, each value is decoded
+ * from a single word load. The values whose code does not fit in the loaded
+ * word and the ones near the end of the buffer are read bit field by bit field.
+ *
+ * @param data_input     Bits and bytes are read from there.
+ * @param rice_parameter The number of low bits following the unary high part.
+ * @param values         Where the decoded values are put.
+ * @param nb_values      The number of values to read.
+ *
+ * @return Return 0 if successful, -1 else.
+ */
+int get_rice_values(data_input_t* data_input, uint8_t rice_parameter, int32_t* values, uint16_t nb_values) {
+
+    int32_t* last_value = values + nb_values;
+    int error_code = 0;
+
+    while(values < last_value) {
+        /* The read position is kept in registers while words can be loaded. */
+        const uint8_t* buffer = data_input->buffer;
+        int position = data_input->position;
+        int last_position = data_input->read_size - (int)sizeof(input_word_t);
+        uint8_t shift = data_input->shift;
+        uint32_t value = 0;
+
+        for(; (values < last_value) && (position <= last_position); ++values) {
+            input_word_t word = load_big_endian_word(buffer + position) << shift;
+            uint8_t nb_leading_zeros = 0;
+            uint8_t nb_consumed_bits = 0;
+
+            if(word == 0)
+                break;
+
+            nb_leading_zeros = count_leading_zeros(word);
+            nb_consumed_bits = shift + nb_leading_zeros + 1 + rice_parameter;
+            if(nb_consumed_bits > (sizeof(input_word_t) * 8))
+                break;
+
+            /* The one bit ending the unary part lands just above the low bits. */
+            value = ((uint32_t)nb_leading_zeros << rice_parameter) | ((uint32_t)((word << nb_leading_zeros) >> ((sizeof(input_word_t) * 8) - 1 - rice_parameter)) ^ (((uint32_t)1) << rice_parameter));
+            *values = (value & 0x01) ? -(int32_t)(value >> 1) - 1 : (int32_t)(value >> 1);
+            position += nb_consumed_bits >> 3;
+            shift = nb_consumed_bits & 7;
+        }
+
+        data_input->position = position;
+        data_input->shift = shift;
+
+        if(values == last_value)
+            break;
+
+        /* Near the end of the buffer or with a code not fitting in a word. */
+        value = get_unary_value(data_input, &error_code) << rice_parameter;
+        if(error_code == -1)
+            return -1;
+
+        value |= get_shifted_bits(data_input, rice_parameter, &error_code);
+        if(error_code == -1)
+            return -1;
+
+        *values++ = (value & 0x01) ? -(int32_t)(value >> 1) - 1 : (int32_t)(value >> 1);
     }
 
-    return value;
+    return 0;
 
 }
@@ -8,21 +8,63 @@
 #ifndef INPUT_H
 #define INPUT_H
 #include <stdint.h>
+#include <sys/types.h>
 #include <unistd.h>
 
+#include "crc.h"
+
+/**
+ * Bits are read from the input by loading a whole big endian word at the
+ * current position. At most 7 bits of the word may be already consumed so a
+ * single load can return up to the word size minus 7 bits.
+ */
+#ifdef DISALLOW_64_BITS
+typedef uint32_t input_word_t;
+#define INPUT_WORD_MAX_READ_SIZE 25
+#else
+typedef uint64_t input_word_t;
+#define INPUT_WORD_MAX_READ_SIZE 57
+#endif
+
+/**
+ * Number of bytes allocated after the end of the input buffer so a word can
+ * always be loaded from a position inside the buffer.
+ */
+#define INPUT_BUFFER_PADDING sizeof(input_word_t)
+
+/**
+ * What to do about the CRCs of the frames: ignore them, warn about the ones
+ * not matching or stop at the first one not matching.
+ */
+#define CRC_CHECK_OFF    0
+#define CRC_CHECK_WARN   1
+#define CRC_CHECK_STRICT 2
+
 /**
  * Represent the input stream.
  */
 typedef struct {
     int fd;             /**< A file descriptor of the file being read. */
     uint8_t* buffer;    /**< Used to buffer read data. */
+    off_t offset;       /**< The absolute position in the stream of the
+                             start of the buffer. */
     int size;           /**< The size of the buffer. */
     int read_size;      /**< The size of the read data in the buffer. */
     int position;       /**< The current read position in the buffer. */
     uint8_t shift;      /**< The current bit shift inside the current byte. */
+    uint8_t is_mapped;  /**< Is the buffer a memory mapping of the whole
+                             file. */
+    uint8_t crc_check;  /**< One of the CRC_CHECK_* values. */
+    uint16_t crc16;     /**< The CRC-16 of the bytes of the current frame
+                             before crc_position. */
+    int crc_position;   /**< The position in the buffer of the first byte of
+                             the current frame not yet in crc16. */
+    uint8_t should_resync;/**< Should the decoding go on from the next valid
+                               frame header after a damaged frame instead of
+                               stopping? */
 } data_input_t;
 
-#define DATA_INPUT_INIT() {.fd = 0, .buffer = NULL, .size = 0, .read_size = 0, .position = 0, .shift = 0}
+#define DATA_INPUT_INIT() {.fd = 0, .buffer = NULL, .offset = 0, .size = 0, .read_size = 0, .position = 0, .shift = 0, .is_mapped = 0, .crc_check = CRC_CHECK_OFF, .crc16 = 0, .crc_position = 0, .should_resync = 0}
 
 /**
  * Init the input from a file descriptor.
@@ -35,6 +77,28 @@ typedef struct {
  */
 int init_data_input_from_fd(data_input_t* data_input, int fd, int buffer_size);
 
+/**
+ * Init the input from a memory mapping of the whole file behind a file
+ * descriptor. The mapping is then used as the input buffer and is never
+ * refilled. A file too big for the positions in the buffer is read through an
+ * input buffer instead.
+ *
+ * @param data_input  The structure representing the input to fill out.
+ * @param fd          The input file descriptor. Should be a regular file.
+ * @param buffer_size The size of the input buffer if the file is too big to be
+ *                    mapped.
+ *
+ * @return Return 0 if successful, -1 else.
+ */
+int init_data_input_from_mmap(data_input_t* data_input, int fd, int buffer_size);
+
+/**
+ * Free the input buffer or unmap it if the input was memory mapped.
+ *
+ * @param data_input The input to free.
+ */
+void free_data_input(data_input_t* data_input);
+
 /**
  * Get the position in the input stream for later skipping back.
  *
@@ -42,9 +106,9 @@ int init_data_input_from_fd(data_input_t* data_input, int fd, int buffer_size);
  *
  * @return Return the position.
  */
-static inline int get_position(data_input_t* data_input) {
+static inline off_t get_position(data_input_t* data_input) {
 
-    return lseek(data_input->fd, 0, SEEK_CUR) - data_input->read_size + data_input->position;
+    return data_input->offset + data_input->position;
 
 }
 
@@ -56,7 +120,7 @@ static inline int get_position(data_input_t* data_input) {
  *
  * @return Return -1 if an error occurred, 0 else.
  */
-int skip_to_position(data_input_t* data_input, int position);
+int skip_to_position(data_input_t* data_input, off_t position);
 
 /**
  * Skip a given number of bits and refill the buffer if necessary.
@@ -98,7 +162,8 @@ int refill_input_buffer_at_least(data_input_t* data_input, int nb_needed_bytes);
 
 /**
  * Try to refill the input buffer from the last position while preserving any
- * unused bytes in the input buffer.
+ * unused bytes in the input buffer. If the CRCs are checked, the consumed
+ * bytes of the current frame are added to its CRC-16 before being dropped.
  *
  * @param data_input Contain the input buffer and the necessary information to
  *                   refill it.
@@ -119,6 +184,18 @@ int refill_input_buffer(data_input_t* data_input);
  */
 uint8_t get_one_shifted_bit(data_input_t* data_input, int* error_code);
 
+/**
+ * Read a unary coded value, that is a run of zero bits ended by a one bit, and
+ * return the number of zero bits. The whole run inside a loaded word is
+ * consumed at once.
+ *
+ * @param data_input     Bits and bytes are read from there.
+ * @param error_code     If any error occurs, it will be equal to -1.
+ *
+ * @return Return the number of zero bits before the one bit.
+ */
+uint32_t get_unary_value(data_input_t* data_input, int* error_code);
+
 /**
  * Get bits from the input taking into shift in byte.
  *
@@ -134,4 +211,30 @@ uint32_t get_shifted_bits(data_input_t* data_input, uint8_t requested_size, int*
 uint64_t get_shifted_bits(data_input_t* data_input, uint8_t requested_size, int* error_code);
 #endif
 
+/**
+ * Add the consumed bytes of the current frame not yet in its CRC-16 to it.
+ *
+ * @param data_input Contain the input buffer and the CRC-16 of the frame.
+ */
+static inline void update_frame_crc16(data_input_t* data_input) {
+
+    data_input->crc16 = crc16(data_input->crc16, data_input->buffer + data_input->crc_position, data_input->position - data_input->crc_position);
+    data_input->crc_position = data_input->position;
+
+}
+
+/**
+ * Read a run of rice coded signed values sharing the same rice parameter. As
+ * long as a whole word can be loaded from the buffer, each value is decoded
+ * from a single word load.
+ *
+ * @param data_input     Bits and bytes are read from there.
+ * @param rice_parameter The number of low bits following the unary high part.
+ * @param values         Where the decoded values are put.
+ * @param nb_values      The number of values to read.
+ *
+ * @return Return 0 if successful, -1 else.
+ */
+int get_rice_values(data_input_t* data_input, uint8_t rice_parameter, int32_t* values, uint16_t nb_values);
+
 #endif
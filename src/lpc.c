@@ -0,0 +1,619 @@
+/**
+ * Copyright © 2013 Jean-François Hren <jfhren@gmail.com>
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+#include <stdint.h>
+
+#include "lpc.h"
+
+/**
+ * The vectorised kernels are only built for x86 with a compiler supporting
+ * per function target. They can be left out with DISALLOW_SIMD.
+ */
+#if !defined DISALLOW_SIMD && defined __GNUC__ && (defined __x86_64__ || defined __i386__)
+    #define LPC_X86_KERNELS
+    #include <immintrin.h>
+#endif
+
+#ifdef LPC_X86_KERNELS
+static uint8_t g_has_sse41 = 0;
+static uint8_t g_has_avx2 = 0;
+#endif
+
+/**
+ * Fixed predictors restoring the samples of a fixed subframe in place. Each
+ * sample holds its residual and the prediction from the order previous
+ * samples is added to it.
+ *
+ * @param sample      The first sample to restore.
+ * @param last_sample One past the last sample to restore.
+ */
+static void restore_fixed_0(int32_t* sample, int32_t* last_sample) {
+
+    (void)sample;
+    (void)last_sample;
+
+}
+
+static void restore_fixed_1(int32_t* sample, int32_t* last_sample) {
+
+    for(; sample < last_sample; ++sample)
+        *sample += sample[-1];
+
+}
+
+static void restore_fixed_2(int32_t* sample, int32_t* last_sample) {
+
+    for(; sample < last_sample; ++sample)
+        *sample += (sample[-1] << 1) - sample[-2];
+
+}
+
+static void restore_fixed_3(int32_t* sample, int32_t* last_sample) {
+
+    for(; sample < last_sample; ++sample)
+        *sample += 3 * (sample[-1] - sample[-2]) + sample[-3];
+
+}
+
+static void restore_fixed_4(int32_t* sample, int32_t* last_sample) {
+
+    for(; sample < last_sample; ++sample)
+        *sample += ((sample[-1] + sample[-3]) << 2) - 6 * sample[-2] - sample[-4];
+
+}
+
+static const fixed_restore_func_t g_restore_fixed[5] = {restore_fixed_0, restore_fixed_1, restore_fixed_2, restore_fixed_3, restore_fixed_4};
+
+#ifdef DECODE_32_BITS
+/**
+ * The predictions of the second to fourth order predictors go through
+ * intermediate values larger than the samples. With samples on 32 bits, they
+ * are computed on 64 bits and only the restored sample is kept on 32 bits.
+ */
+static void restore_fixed_2_64(int32_t* sample, int32_t* last_sample) {
+
+    for(; sample < last_sample; ++sample)
+        *sample += ((int64_t)sample[-1] << 1) - sample[-2];
+
+}
+
+static void restore_fixed_3_64(int32_t* sample, int32_t* last_sample) {
+
+    for(; sample < last_sample; ++sample)
+        *sample += 3 * ((int64_t)sample[-1] - sample[-2]) + sample[-3];
+
+}
+
+static void restore_fixed_4_64(int32_t* sample, int32_t* last_sample) {
+
+    for(; sample < last_sample; ++sample)
+        *sample += (((int64_t)sample[-1] + sample[-3]) << 2) - 6 * (int64_t)sample[-2] - sample[-4];
+
+}
+
+static const fixed_restore_func_t g_restore_fixed_64[5] = {restore_fixed_0, restore_fixed_1, restore_fixed_2_64, restore_fixed_3_64, restore_fixed_4_64};
+#endif
+
+
+/**
+ * Apply the lpc shift to a prediction. A positive shift is a division rounded
+ * toward minus infinity, done on the one's complement of negative values so
+ * only non negative values are shifted.
+ */
+#define SHIFT_PREDICTION(value, shift, type) \
+    do { \
+        if((shift) < 0) { \
+            (value) = (value) << (uint8_t)(-(shift)); \
+        } else { \
+            type mask = -(type)((value) < 0); \
+            (value) = (((value) ^ mask) >> (shift)) ^ mask; \
+        } \
+    } while(0)
+
+/**
+ * The lpc orders for which a kernel is generated.
+ */
+#define LPC_ORDERS(X) \
+    X(1) X(2) X(3) X(4) X(5) X(6) X(7) X(8) \
+    X(9) X(10) X(11) X(12) X(13) X(14) X(15) X(16) \
+    X(17) X(18) X(19) X(20) X(21) X(22) X(23) X(24) \
+    X(25) X(26) X(27) X(28) X(29) X(30) X(31) X(32)
+
+/**
+ * Accumulate the taps of a prediction up to a given order, the first
+ * coefficient going with the most recent sample. The loop over the taps is
+ * unrolled by the preprocessor.
+ */
+#define LPC_TAPS_1(value, sample, coeffs, type) (value) += (coeffs)[0] * (type)(sample)[-1]
+#define LPC_TAPS_2(value, sample, coeffs, type) LPC_TAPS_1(value, sample, coeffs, type); (value) += (coeffs)[1] * (type)(sample)[-2]
+#define LPC_TAPS_3(value, sample, coeffs, type) LPC_TAPS_2(value, sample, coeffs, type); (value) += (coeffs)[2] * (type)(sample)[-3]
+#define LPC_TAPS_4(value, sample, coeffs, type) LPC_TAPS_3(value, sample, coeffs, type); (value) += (coeffs)[3] * (type)(sample)[-4]
+#define LPC_TAPS_5(value, sample, coeffs, type) LPC_TAPS_4(value, sample, coeffs, type); (value) += (coeffs)[4] * (type)(sample)[-5]
+#define LPC_TAPS_6(value, sample, coeffs, type) LPC_TAPS_5(value, sample, coeffs, type); (value) += (coeffs)[5] * (type)(sample)[-6]
+#define LPC_TAPS_7(value, sample, coeffs, type) LPC_TAPS_6(value, sample, coeffs, type); (value) += (coeffs)[6] * (type)(sample)[-7]
+#define LPC_TAPS_8(value, sample, coeffs, type) LPC_TAPS_7(value, sample, coeffs, type); (value) += (coeffs)[7] * (type)(sample)[-8]
+#define LPC_TAPS_9(value, sample, coeffs, type) LPC_TAPS_8(value, sample, coeffs, type); (value) += (coeffs)[8] * (type)(sample)[-9]
+#define LPC_TAPS_10(value, sample, coeffs, type) LPC_TAPS_9(value, sample, coeffs, type); (value) += (coeffs)[9] * (type)(sample)[-10]
+#define LPC_TAPS_11(value, sample, coeffs, type) LPC_TAPS_10(value, sample, coeffs, type); (value) += (coeffs)[10] * (type)(sample)[-11]
+#define LPC_TAPS_12(value, sample, coeffs, type) LPC_TAPS_11(value, sample, coeffs, type); (value) += (coeffs)[11] * (type)(sample)[-12]
+#define LPC_TAPS_13(value, sample, coeffs, type) LPC_TAPS_12(value, sample, coeffs, type); (value) += (coeffs)[12] * (type)(sample)[-13]
+#define LPC_TAPS_14(value, sample, coeffs, type) LPC_TAPS_13(value, sample, coeffs, type); (value) += (coeffs)[13] * (type)(sample)[-14]
+#define LPC_TAPS_15(value, sample, coeffs, type) LPC_TAPS_14(value, sample, coeffs, type); (value) += (coeffs)[14] * (type)(sample)[-15]
+#define LPC_TAPS_16(value, sample, coeffs, type) LPC_TAPS_15(value, sample, coeffs, type); (value) += (coeffs)[15] * (type)(sample)[-16]
+#define LPC_TAPS_17(value, sample, coeffs, type) LPC_TAPS_16(value, sample, coeffs, type); (value) += (coeffs)[16] * (type)(sample)[-17]
+#define LPC_TAPS_18(value, sample, coeffs, type) LPC_TAPS_17(value, sample, coeffs, type); (value) += (coeffs)[17] * (type)(sample)[-18]
+#define LPC_TAPS_19(value, sample, coeffs, type) LPC_TAPS_18(value, sample, coeffs, type); (value) += (coeffs)[18] * (type)(sample)[-19]
+#define LPC_TAPS_20(value, sample, coeffs, type) LPC_TAPS_19(value, sample, coeffs, type); (value) += (coeffs)[19] * (type)(sample)[-20]
+#define LPC_TAPS_21(value, sample, coeffs, type) LPC_TAPS_20(value, sample, coeffs, type); (value) += (coeffs)[20] * (type)(sample)[-21]
+#define LPC_TAPS_22(value, sample, coeffs, type) LPC_TAPS_21(value, sample, coeffs, type); (value) += (coeffs)[21] * (type)(sample)[-22]
+#define LPC_TAPS_23(value, sample, coeffs, type) LPC_TAPS_22(value, sample, coeffs, type); (value) += (coeffs)[22] * (type)(sample)[-23]
+#define LPC_TAPS_24(value, sample, coeffs, type) LPC_TAPS_23(value, sample, coeffs, type); (value) += (coeffs)[23] * (type)(sample)[-24]
+#define LPC_TAPS_25(value, sample, coeffs, type) LPC_TAPS_24(value, sample, coeffs, type); (value) += (coeffs)[24] * (type)(sample)[-25]
+#define LPC_TAPS_26(value, sample, coeffs, type) LPC_TAPS_25(value, sample, coeffs, type); (value) += (coeffs)[25] * (type)(sample)[-26]
+#define LPC_TAPS_27(value, sample, coeffs, type) LPC_TAPS_26(value, sample, coeffs, type); (value) += (coeffs)[26] * (type)(sample)[-27]
+#define LPC_TAPS_28(value, sample, coeffs, type) LPC_TAPS_27(value, sample, coeffs, type); (value) += (coeffs)[27] * (type)(sample)[-28]
+#define LPC_TAPS_29(value, sample, coeffs, type) LPC_TAPS_28(value, sample, coeffs, type); (value) += (coeffs)[28] * (type)(sample)[-29]
+#define LPC_TAPS_30(value, sample, coeffs, type) LPC_TAPS_29(value, sample, coeffs, type); (value) += (coeffs)[29] * (type)(sample)[-30]
+#define LPC_TAPS_31(value, sample, coeffs, type) LPC_TAPS_30(value, sample, coeffs, type); (value) += (coeffs)[30] * (type)(sample)[-31]
+#define LPC_TAPS_32(value, sample, coeffs, type) LPC_TAPS_31(value, sample, coeffs, type); (value) += (coeffs)[31] * (type)(sample)[-32]
+
+/**
+ * Define the portable kernel restoring the samples of a lpc subframe of a given
+ * order one at a time, the prediction being accumulated on the given number of
+ * bits. The order parameter is ignored since it is the one of the kernel.
+ */
+#define DEFINE_RESTORE_LPC(order, bits) \
+    static void restore_lpc_##bits##_##order(int32_t* sample, int32_t* last_sample, const int16_t* coeffs, uint8_t lpc_order, int8_t shift) { \
+        (void)lpc_order; \
+        for(; sample < last_sample; ++sample) { \
+            int##bits##_t value = 0; \
+            LPC_TAPS_##order(value, sample, coeffs, int##bits##_t); \
+            SHIFT_PREDICTION(value, shift, int##bits##_t); \
+            *sample += value; \
+        } \
+    }
+
+#define DEFINE_RESTORE_LPC_32(order) DEFINE_RESTORE_LPC(order, 32)
+#define RESTORE_LPC_32(order) restore_lpc_32_##order,
+
+LPC_ORDERS(DEFINE_RESTORE_LPC_32)
+
+/**
+ * The portable kernels accumulating on 32 bits indexed by order minus one.
+ * They work for any shift as long as the prediction fits on 32 bits.
+ */
+static const lpc_restore_func_t g_restore_lpc_32[32] = {LPC_ORDERS(RESTORE_LPC_32)};
+
+#ifndef DISALLOW_64_BITS
+#define DEFINE_RESTORE_LPC_64(order) DEFINE_RESTORE_LPC(order, 64)
+#define RESTORE_LPC_64(order) restore_lpc_64_##order,
+
+LPC_ORDERS(DEFINE_RESTORE_LPC_64)
+
+/**
+ * The portable kernels accumulating on 64 bits indexed by order minus one.
+ * They work for any shift.
+ */
+static const lpc_restore_func_t g_restore_lpc_64[32] = {LPC_ORDERS(RESTORE_LPC_64)};
+
+#undef DEFINE_RESTORE_LPC_64
+#undef RESTORE_LPC_64
+#endif
+
+#undef DEFINE_RESTORE_LPC_32
+#undef RESTORE_LPC_32
+#undef DEFINE_RESTORE_LPC
+
+#ifdef DECODE_WIDE_SIDE
+
+/**
+ * Restore the 64 bits samples of the 33 bits side channel of a 32 bits stream
+ * from its residuals with a fixed predictor. The order previous samples are the
+ * warm-up samples.
+ *
+ * @param sample      The first sample to restore.
+ * @param last_sample One past the last sample to restore.
+ * @param residual    The residual of the first sample to restore.
+ * @param order       The order of the fixed predictor, from zero to four.
+ */
+void restore_fixed_wide(int64_t* sample, int64_t* last_sample, const int32_t* residual, uint8_t order) {
+
+    switch(order) {
+        case 0:
+            for(; sample < last_sample; ++sample, ++residual)
+                *sample = *residual;
+            break;
+
+        case 1:
+            for(; sample < last_sample; ++sample, ++residual)
+                *sample = *residual + sample[-1];
+            break;
+
+        case 2:
+            for(; sample < last_sample; ++sample, ++residual)
+                *sample = *residual + (sample[-1] << 1) - sample[-2];
+            break;
+
+        case 3:
+            for(; sample < last_sample; ++sample, ++residual)
+                *sample = *residual + 3 * (sample[-1] - sample[-2]) + sample[-3];
+            break;
+
+        default:
+            for(; sample < last_sample; ++sample, ++residual)
+                *sample = *residual + ((sample[-1] + sample[-3]) << 2) - 6 * sample[-2] - sample[-4];
+    }
+
+}
+
+
+/**
+ * Restore the 64 bits samples of the 33 bits side channel of a 32 bits stream
+ * from its residuals with a lpc predictor. The order previous samples are the
+ * warm-up samples.
+ *
+ * @param sample      The first sample to restore.
+ * @param last_sample One past the last sample to restore.
+ * @param residual    The residual of the first sample to restore.
+ * @param coeffs      The lpc coefficients, the first one going with the most
+ *                    recent sample.
+ * @param order       The lpc order.
+ * @param shift       The lpc shift applied to the prediction.
+ */
+void restore_lpc_wide(int64_t* sample, int64_t* last_sample, const int32_t* residual, const int16_t* coeffs, uint8_t order, int8_t shift) {
+
+    for(; sample < last_sample; ++sample, ++residual) {
+        int64_t value = 0;
+        uint8_t i = 0;
+
+        for(; i < order; ++i)
+            value += coeffs[i] * sample[-1 - i];
+
+        SHIFT_PREDICTION(value, shift, int64_t);
+        *sample = *residual + value;
+    }
+
+}
+
+#endif
+
+#undef SHIFT_PREDICTION
+
+
+#ifdef LPC_X86_KERNELS
+
+/**
+ * The vectorised kernels restore a run of consecutive samples at once, one per
+ * lane. The taps reaching only samples before the run are accumulated with
+ * vector multiplications. The first taps of the later lanes need samples of
+ * the run itself, so these taps are added one sample at a time once the
+ * previous sample is restored, the last restored samples being kept in
+ * registers. These kernels are only used with a positive shift and only built
+ * with GCC compatible compilers, which shift negative values arithmetically,
+ * so the shift is done without a branch.
+ */
+#define RESTORE_ONE_SAMPLE(restored, sample, prediction, shift) \
+    do { \
+        (restored) = (sample) + ((prediction) >> (shift)); \
+    } while(0)
+
+/**
+ * Restore four samples of a run whose predictions already hold every tap but
+ * the first three, s1 to s3 being the three samples before the run.
+ */
+#define RESTORE_FOUR_SAMPLES(sample, predictions, coeffs, shift, s1, s2, s3, type) \
+    do { \
+        type v0, v1, v2, v3; \
+        RESTORE_ONE_SAMPLE(v0, (sample)[0], (predictions)[0] + (coeffs)[0] * (s1) + (coeffs)[1] * (s2) + (coeffs)[2] * (s3), (shift)); \
+        RESTORE_ONE_SAMPLE(v1, (sample)[1], (predictions)[1] + (coeffs)[0] * v0 + (coeffs)[1] * (s1) + (coeffs)[2] * (s2), (shift)); \
+        RESTORE_ONE_SAMPLE(v2, (sample)[2], (predictions)[2] + (coeffs)[0] * v1 + (coeffs)[1] * v0 + (coeffs)[2] * (s1), (shift)); \
+        RESTORE_ONE_SAMPLE(v3, (sample)[3], (predictions)[3] + (coeffs)[0] * v2 + (coeffs)[1] * v1 + (coeffs)[2] * v0, (shift)); \
+        (sample)[0] = v0; \
+        (sample)[1] = v1; \
+        (sample)[2] = v2; \
+        (sample)[3] = v3; \
+        (s3) = v1; \
+        (s2) = v2; \
+        (s1) = v3; \
+    } while(0)
+
+/**
+ * Restore the samples of a lpc subframe four at a time with 32 bits
+ * multiply-accumulate. The prediction should fit on 32 bits and the order
+ * should be at least 4.
+ */
+__attribute__((target("sse4.1")))
+static void restore_lpc_32_sse41(int32_t* sample, int32_t* last_sample, const int16_t* coeffs, uint8_t order, int8_t shift) {
+
+    __m128i vector_coeffs[32];
+    int32_t s1 = sample[-1];
+    int32_t s2 = sample[-2];
+    int32_t s3 = sample[-3];
+    uint8_t i = 3;
+
+    for(; i < order; ++i)
+        vector_coeffs[i] = _mm_set1_epi32(coeffs[i]);
+
+    for(; (last_sample - sample) >= 4; sample += 4) {
+        int32_t predictions[4];
+        __m128i sum = _mm_mullo_epi32(vector_coeffs[3], _mm_loadu_si128((const __m128i*)(sample - 4)));
+
+        for(i = 4; i < order; ++i)
+            sum = _mm_add_epi32(sum, _mm_mullo_epi32(vector_coeffs[i], _mm_loadu_si128((const __m128i*)(sample - 1 - i))));
+
+        _mm_storeu_si128((__m128i*)predictions, sum);
+        RESTORE_FOUR_SAMPLES(sample, predictions, coeffs, shift, s1, s2, s3, int32_t);
+    }
+
+    g_restore_lpc_32[order - 1](sample, last_sample, coeffs, order, shift);
+
+}
+
+
+/**
+ * Restore the samples of a lpc subframe eight at a time with 32 bits
+ * multiply-accumulate. The taps from the eighth one are accumulated for the
+ * eight lanes at once. The fourth to seventh taps of the last four lanes need
+ * the first four restored samples and are accumulated in a second step from
+ * registers. The prediction should fit on 32 bits and the order should be at
+ * least 8.
+ */
+__attribute__((target("avx2")))
+static void restore_lpc_32_avx2(int32_t* sample, int32_t* last_sample, const int16_t* coeffs, uint8_t order, int8_t shift) {
+
+    __m256i vector_coeffs[32];
+    __m128i low_coeffs[7];
+    int32_t s1 = sample[-1];
+    int32_t s2 = sample[-2];
+    int32_t s3 = sample[-3];
+    uint8_t i = 3;
+
+    for(; i < 7; ++i)
+        low_coeffs[i] = _mm_set1_epi32(coeffs[i]);
+
+    for(; i < order; ++i)
+        vector_coeffs[i] = _mm256_set1_epi32(coeffs[i]);
+
+    for(; (last_sample - sample) >= 8; sample += 8) {
+        int32_t predictions[8];
+        __m256i sum = _mm256_mullo_epi32(vector_coeffs[7], _mm256_loadu_si256((const __m256i*)(sample - 8)));
+        __m128i previous = _mm_loadu_si128((const __m128i*)(sample - 4));
+        __m128i restored;
+        __m128i low_sum;
+
+        for(i = 8; i < order; ++i)
+            sum = _mm256_add_epi32(sum, _mm256_mullo_epi32(vector_coeffs[i], _mm256_loadu_si256((const __m256i*)(sample - 1 - i))));
+
+        /* Fourth to seventh taps of the first four lanes. */
+        low_sum = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm_mullo_epi32(low_coeffs[3], previous));
+        for(i = 4; i < 7; ++i)
+            low_sum = _mm_add_epi32(low_sum, _mm_mullo_epi32(low_coeffs[i], _mm_loadu_si128((const __m128i*)(sample - 1 - i))));
+
+        _mm_storeu_si128((__m128i*)predictions, low_sum);
+        RESTORE_FOUR_SAMPLES(sample, predictions, coeffs, shift, s1, s2, s3, int32_t);
+
+        /* Fourth to seventh taps of the last four lanes. */
+        restored = _mm_set_epi32(s1, s2, s3, sample[0]);
+        low_sum = _mm256_extracti128_si256(sum, 1);
+        low_sum = _mm_add_epi32(low_sum, _mm_mullo_epi32(low_coeffs[3], restored));
+        low_sum = _mm_add_epi32(low_sum, _mm_mullo_epi32(low_coeffs[4], _mm_alignr_epi8(restored, previous, 12)));
+        low_sum = _mm_add_epi32(low_sum, _mm_mullo_epi32(low_coeffs[5], _mm_alignr_epi8(restored, previous, 8)));
+        low_sum = _mm_add_epi32(low_sum, _mm_mullo_epi32(low_coeffs[6], _mm_alignr_epi8(restored, previous, 4)));
+
+        _mm_storeu_si128((__m128i*)predictions, low_sum);
+        RESTORE_FOUR_SAMPLES(sample + 4, predictions, coeffs, shift, s1, s2, s3, int32_t);
+    }
+
+    g_restore_lpc_32[order - 1](sample, last_sample, coeffs, order, shift);
+
+}
+
+#ifndef DISALLOW_64_BITS
+
+/**
+ * The 64 bits accumulation kernels multiply the low 32 bits of each 64 bits
+ * lane, so the samples are sign extended from 32 bits.
+ */
+#define LOAD_TWO_SAMPLES(sample) _mm_cvtepi32_epi64(_mm_loadl_epi64((const __m128i*)(sample)))
+#define LOAD_FOUR_SAMPLES(sample) _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i*)(sample)))
+
+/**
+ * Restore the samples of a lpc subframe two at a time with 64 bits
+ * accumulation. The samples should fit on 32 bits and the order should be at
+ * least 2.
+ */
+__attribute__((target("sse4.1")))
+static void restore_lpc_64_sse41(int32_t* sample, int32_t* last_sample, const int16_t* coeffs, uint8_t order, int8_t shift) {
+
+    __m128i vector_coeffs[32];
+    int64_t s1 = sample[-1];
+    uint8_t i = 1;
+
+    for(; i < order; ++i)
+        vector_coeffs[i] = _mm_set1_epi64x(coeffs[i]);
+
+    for(; (last_sample - sample) >= 2; sample += 2) {
+        int64_t predictions[2];
+        int64_t v0;
+        __m128i sum = _mm_mul_epi32(vector_coeffs[1], LOAD_TWO_SAMPLES(sample - 2));
+
+        for(i = 2; i < order; ++i)
+            sum = _mm_add_epi64(sum, _mm_mul_epi32(vector_coeffs[i], LOAD_TWO_SAMPLES(sample - 1 - i)));
+
+        _mm_storeu_si128((__m128i*)predictions, sum);
+        RESTORE_ONE_SAMPLE(v0, sample[0], predictions[0] + coeffs[0] * s1, shift);
+        RESTORE_ONE_SAMPLE(s1, sample[1], predictions[1] + coeffs[0] * v0, shift);
+        sample[0] = v0;
+        sample[1] = s1;
+    }
+
+    g_restore_lpc_64[order - 1](sample, last_sample, coeffs, order, shift);
+
+}
+
+
+/**
+ * Restore the samples of a lpc subframe four at a time with 64 bits
+ * accumulation. The samples should fit on 32 bits and the order should be at
+ * least 4.
+ */
+__attribute__((target("avx2")))
+static void restore_lpc_64_avx2(int32_t* sample, int32_t* last_sample, const int16_t* coeffs, uint8_t order, int8_t shift) {
+
+    __m256i vector_coeffs[32];
+    int64_t s1 = sample[-1];
+    int64_t s2 = sample[-2];
+    int64_t s3 = sample[-3];
+    uint8_t i = 3;
+
+    for(; i < order; ++i)
+        vector_coeffs[i] = _mm256_set1_epi64x(coeffs[i]);
+
+    for(; (last_sample - sample) >= 4; sample += 4) {
+        int64_t predictions[4];
+        __m256i sum = _mm256_mul_epi32(vector_coeffs[3], LOAD_FOUR_SAMPLES(sample - 4));
+
+        for(i = 4; i < order; ++i)
+            sum = _mm256_add_epi64(sum, _mm256_mul_epi32(vector_coeffs[i], LOAD_FOUR_SAMPLES(sample - 1 - i)));
+
+        _mm256_storeu_si256((__m256i*)predictions, sum);
+        RESTORE_FOUR_SAMPLES(sample, predictions, coeffs, shift, s1, s2, s3, int64_t);
+    }
+
+    g_restore_lpc_64[order - 1](sample, last_sample, coeffs, order, shift);
+
+}
+
+#undef LOAD_TWO_SAMPLES
+#undef LOAD_FOUR_SAMPLES
+
+#endif
+
+#undef RESTORE_ONE_SAMPLE
+#undef RESTORE_FOUR_SAMPLES
+
+#endif
+
+
+/**
+ * Tell if the prediction of a lpc subframe can be accumulated on 32 bits
+ * without overflowing. The prediction is bounded by the sum of the absolute
+ * values of the coefficients times the largest absolute value of a sample.
+ *
+ * @param coeffs          The lpc coefficients.
+ * @param order           The lpc order.
+ * @param bits_per_sample The number of bits of the subframe samples.
+ *
+ * @return Return 1 if the prediction fits on 32 bits, 0 else.
+ */
+static uint8_t does_prediction_fit_in_32_bits(const int16_t* coeffs, uint8_t order, uint8_t bits_per_sample) {
+
+    uint32_t sum_abs_coeffs = 0;
+    uint8_t i = 0;
+
+    if(bits_per_sample > 31)
+        return 0;
+
+    for(; i < order; ++i)
+        sum_abs_coeffs += coeffs[i] < 0 ? -coeffs[i] : coeffs[i];
+
+    return sum_abs_coeffs <= (((uint32_t)INT32_MAX) >> (bits_per_sample - 1));
+
+}
+
+
+/**
+ * Look at what the processor supports (through cpuid) to know which lpc
+ * kernels can be used. Should be called once before any call to
+ * get_lpc_restore_func.
+ */
+void init_lpc_kernels(void) {
+
+#ifdef LPC_X86_KERNELS
+    __builtin_cpu_init();
+    g_has_sse41 = __builtin_cpu_supports("sse4.1") ? 1 : 0;
+    g_has_avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+#endif
+
+}
+
+
+/**
+ * Select the fastest lpc kernel able to restore a given subframe. The
+ * prediction is accumulated on 32 bits if it cannot overflow and on 64 bits
+ * else.
+ *
+ * @param coeffs          The lpc coefficients of the subframe.
+ * @param order           The lpc order of the subframe.
+ * @param shift           The lpc shift of the subframe.
+ * @param bits_per_sample The number of bits of the subframe samples (wasted
+ *                        bits excluded).
+ *
+ * @return Return the kernel to use for restoring the subframe.
+ */
+lpc_restore_func_t get_lpc_restore_func(const int16_t* coeffs, uint8_t order, int8_t shift, uint8_t bits_per_sample) {
+
+    uint8_t fits_in_32_bits = does_prediction_fit_in_32_bits(coeffs, order, bits_per_sample);
+
+#ifdef LPC_X86_KERNELS
+    if(shift >= 0) {
+        if(fits_in_32_bits) {
+            if(g_has_avx2 && (order >= 8))
+                return restore_lpc_32_avx2;
+
+            if(g_has_sse41 && (order >= 4))
+                return restore_lpc_32_sse41;
+        }
+#ifndef DISALLOW_64_BITS
+        /* These kernels beat the 64 bits accumulation done one sample at a
+           time. */
+        if(!fits_in_32_bits) {
+            if(g_has_avx2 && (order >= 4))
+                return restore_lpc_64_avx2;
+
+            if(g_has_sse41 && (order >= 2))
+                return restore_lpc_64_sse41;
+        }
+#endif
+    }
+#else
+    (void)shift;
+#endif
+
+#ifndef DISALLOW_64_BITS
+    if(!fits_in_32_bits)
+        return g_restore_lpc_64[order - 1];
+#endif
+
+    return g_restore_lpc_32[order - 1];
+
+}
+
+
+/**
+ * Select the kernel restoring a fixed subframe of a given order. The
+ * intermediate values of the prediction fit on 32 bits up to 28 bits per
+ * sample since the absolute values of the coefficients sum up to 16 at most.
+ *
+ * @param order           The order of the fixed predictor, from zero to four.
+ * @param bits_per_sample The number of bits of the subframe samples (wasted
+ *                        bits excluded).
+ *
+ * @return Return the kernel to use for restoring the subframe.
+ */
+fixed_restore_func_t get_fixed_restore_func(uint8_t order, uint8_t bits_per_sample) {
+
+#ifdef DECODE_32_BITS
+    if(bits_per_sample > 28)
+        return g_restore_fixed_64[order];
+#else
+    (void)bits_per_sample;
+#endif
+
+    return g_restore_fixed[order];
+
+}
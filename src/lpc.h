@@ -0,0 +1,100 @@
+/**
+ * Copyright © 2013 Jean-François Hren <jfhren@gmail.com>
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+#ifndef LPC_H
+#define LPC_H
+#include <stdint.h>
+#include "decode_flac.h"
+
+/**
+ * Restore the samples of a lpc subframe in place. Each sample holds its
+ * residual and the prediction computed from the order previous samples is
+ * added to it.
+ *
+ * @param sample      The first sample to restore, the order previous ones being
+ *                    the warm-up samples.
+ * @param last_sample One past the last sample to restore.
+ * @param coeffs      The lpc coefficients, the first one going with the most
+ *                    recent sample.
+ * @param order       The lpc order.
+ * @param shift       The lpc shift applied to the prediction.
+ */
+typedef void(*lpc_restore_func_t)(int32_t* sample, int32_t* last_sample, const int16_t* coeffs, uint8_t order, int8_t shift);
+
+/**
+ * Restore the samples of a fixed subframe in place. Each sample holds its
+ * residual and the prediction of the fixed predictor is added to it.
+ *
+ * @param sample      The first sample to restore, the order previous ones being
+ *                    the warm-up samples.
+ * @param last_sample One past the last sample to restore.
+ */
+typedef void(*fixed_restore_func_t)(int32_t* sample, int32_t* last_sample);
+
+/**
+ * Look at what the processor supports (through cpuid) to know which lpc
+ * kernels can be used. Should be called once before any call to
+ * get_lpc_restore_func.
+ */
+void init_lpc_kernels(void);
+
+/**
+ * Select the fastest lpc kernel able to restore a given subframe. The
+ * prediction is accumulated on 32 bits if it cannot overflow and on 64 bits
+ * else.
+ *
+ * @param coeffs          The lpc coefficients of the subframe.
+ * @param order           The lpc order of the subframe.
+ * @param shift           The lpc shift of the subframe.
+ * @param bits_per_sample The number of bits of the subframe samples (wasted
+ *                        bits excluded).
+ *
+ * @return Return the kernel to use for restoring the subframe.
+ */
+lpc_restore_func_t get_lpc_restore_func(const int16_t* coeffs, uint8_t order, int8_t shift, uint8_t bits_per_sample);
+
+/**
+ * Select the kernel restoring a fixed subframe of a given order.
+ *
+ * @param order           The order of the fixed predictor, from zero to four.
+ * @param bits_per_sample The number of bits of the subframe samples (wasted
+ *                        bits excluded).
+ *
+ * @return Return the kernel to use for restoring the subframe.
+ */
+fixed_restore_func_t get_fixed_restore_func(uint8_t order, uint8_t bits_per_sample);
+
+#ifdef DECODE_WIDE_SIDE
+/**
+ * Restore the 64 bits samples of the 33 bits side channel of a 32 bits stream
+ * from its residuals with a fixed predictor. The order previous samples are the
+ * warm-up samples.
+ *
+ * @param sample      The first sample to restore.
+ * @param last_sample One past the last sample to restore.
+ * @param residual    The residual of the first sample to restore.
+ * @param order       The order of the fixed predictor, from zero to four.
+ */
+void restore_fixed_wide(int64_t* sample, int64_t* last_sample, const int32_t* residual, uint8_t order);
+
+/**
+ * Restore the 64 bits samples of the 33 bits side channel of a 32 bits stream
+ * from its residuals with a lpc predictor. The order previous samples are the
+ * warm-up samples.
+ *
+ * @param sample      The first sample to restore.
+ * @param last_sample One past the last sample to restore.
+ * @param residual    The residual of the first sample to restore.
+ * @param coeffs      The lpc coefficients, the first one going with the most
+ *                    recent sample.
+ * @param order       The lpc order.
+ * @param shift       The lpc shift applied to the prediction.
+ */
+void restore_lpc_wide(int64_t* sample, int64_t* last_sample, const int32_t* residual, const int16_t* coeffs, uint8_t order, int8_t shift);
+#endif
+
+#endif
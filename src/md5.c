@@ -0,0 +1,704 @@
+/**
+ * Copyright © 2013 Jean-François Hren <jfhren@gmail.com>
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "md5.h"
+
+/**
+ * The vectorised kernels are only built for x86 with a compiler supporting
+ * per function target. They can be left out with DISALLOW_SIMD.
+ */
+#if !defined DISALLOW_SIMD && defined __GNUC__ && (defined __x86_64__ || defined __i386__)
+    #define MD5_X86_KERNELS
+    #include <immintrin.h>
+#endif
+
+#ifdef MD5_X86_KERNELS
+static uint8_t g_has_sse2 = 0;
+static uint8_t g_has_avx2 = 0;
+#endif
+
+/**
+ * The size in bytes of the samples hashed at once by md5_update_samples.
+ */
+#define MD5_SAMPLE_BUFFER_SIZE 4096
+
+/**
+ * The number of whole blocks gathered by a computation hashed in lanes.
+ */
+#define MD5_NB_LANE_BLOCKS 1024
+
+/**
+ * The 64 steps of the processing of a block, the four rounds being given as
+ * the steps they are made of. A step takes the four state words in their
+ * rotated order, the index of the word of the block it adds, its constant and
+ * its rotation.
+ */
+#define MD5_STEPS(FF, GG, HH, II) \
+    FF(a, b, c, d, 0, 0xD76AA478u, 7); \
+    FF(d, a, b, c, 1, 0xE8C7B756u, 12); \
+    FF(c, d, a, b, 2, 0x242070DBu, 17); \
+    FF(b, c, d, a, 3, 0xC1BDCEEEu, 22); \
+    FF(a, b, c, d, 4, 0xF57C0FAFu, 7); \
+    FF(d, a, b, c, 5, 0x4787C62Au, 12); \
+    FF(c, d, a, b, 6, 0xA8304613u, 17); \
+    FF(b, c, d, a, 7, 0xFD469501u, 22); \
+    FF(a, b, c, d, 8, 0x698098D8u, 7); \
+    FF(d, a, b, c, 9, 0x8B44F7AFu, 12); \
+    FF(c, d, a, b, 10, 0xFFFF5BB1u, 17); \
+    FF(b, c, d, a, 11, 0x895CD7BEu, 22); \
+    FF(a, b, c, d, 12, 0x6B901122u, 7); \
+    FF(d, a, b, c, 13, 0xFD987193u, 12); \
+    FF(c, d, a, b, 14, 0xA679438Eu, 17); \
+    FF(b, c, d, a, 15, 0x49B40821u, 22); \
+    GG(a, b, c, d, 1, 0xF61E2562u, 5); \
+    GG(d, a, b, c, 6, 0xC040B340u, 9); \
+    GG(c, d, a, b, 11, 0x265E5A51u, 14); \
+    GG(b, c, d, a, 0, 0xE9B6C7AAu, 20); \
+    GG(a, b, c, d, 5, 0xD62F105Du, 5); \
+    GG(d, a, b, c, 10, 0x02441453u, 9); \
+    GG(c, d, a, b, 15, 0xD8A1E681u, 14); \
+    GG(b, c, d, a, 4, 0xE7D3FBC8u, 20); \
+    GG(a, b, c, d, 9, 0x21E1CDE6u, 5); \
+    GG(d, a, b, c, 14, 0xC33707D6u, 9); \
+    GG(c, d, a, b, 3, 0xF4D50D87u, 14); \
+    GG(b, c, d, a, 8, 0x455A14EDu, 20); \
+    GG(a, b, c, d, 13, 0xA9E3E905u, 5); \
+    GG(d, a, b, c, 2, 0xFCEFA3F8u, 9); \
+    GG(c, d, a, b, 7, 0x676F02D9u, 14); \
+    GG(b, c, d, a, 12, 0x8D2A4C8Au, 20); \
+    HH(a, b, c, d, 5, 0xFFFA3942u, 4); \
+    HH(d, a, b, c, 8, 0x8771F681u, 11); \
+    HH(c, d, a, b, 11, 0x6D9D6122u, 16); \
+    HH(b, c, d, a, 14, 0xFDE5380Cu, 23); \
+    HH(a, b, c, d, 1, 0xA4BEEA44u, 4); \
+    HH(d, a, b, c, 4, 0x4BDECFA9u, 11); \
+    HH(c, d, a, b, 7, 0xF6BB4B60u, 16); \
+    HH(b, c, d, a, 10, 0xBEBFBC70u, 23); \
+    HH(a, b, c, d, 13, 0x289B7EC6u, 4); \
+    HH(d, a, b, c, 0, 0xEAA127FAu, 11); \
+    HH(c, d, a, b, 3, 0xD4EF3085u, 16); \
+    HH(b, c, d, a, 6, 0x04881D05u, 23); \
+    HH(a, b, c, d, 9, 0xD9D4D039u, 4); \
+    HH(d, a, b, c, 12, 0xE6DB99E5u, 11); \
+    HH(c, d, a, b, 15, 0x1FA27CF8u, 16); \
+    HH(b, c, d, a, 2, 0xC4AC5665u, 23); \
+    II(a, b, c, d, 0, 0xF4292244u, 6); \
+    II(d, a, b, c, 7, 0x432AFF97u, 10); \
+    II(c, d, a, b, 14, 0xAB9423A7u, 15); \
+    II(b, c, d, a, 5, 0xFC93A039u, 21); \
+    II(a, b, c, d, 12, 0x655B59C3u, 6); \
+    II(d, a, b, c, 3, 0x8F0CCC92u, 10); \
+    II(c, d, a, b, 10, 0xFFEFF47Du, 15); \
+    II(b, c, d, a, 1, 0x85845DD1u, 21); \
+    II(a, b, c, d, 8, 0x6FA87E4Fu, 6); \
+    II(d, a, b, c, 15, 0xFE2CE6E0u, 10); \
+    II(c, d, a, b, 6, 0xA3014314u, 15); \
+    II(b, c, d, a, 13, 0x4E0811A1u, 21); \
+    II(a, b, c, d, 4, 0xF7537E82u, 6); \
+    II(d, a, b, c, 11, 0xBD3AF235u, 10); \
+    II(c, d, a, b, 2, 0x2AD7D2BBu, 15); \
+    II(b, c, d, a, 9, 0xEB86D391u, 21);
+
+/**
+ * The steps of the four rounds on one computation. F is written with one
+ * operation less than in the RFC 1321. G is added in two halves, (b & d) and
+ * (c & ~d) having no bit in common, the one not depending on the previous
+ * step result first so both are computed in parallel.
+ */
+#define MD5_ROTATE(x, shift) (((x) << (shift)) | ((x) >> (32 - (shift))))
+
+#define MD5_FF(a, b, c, d, i, constant, shift) \
+    (a) += ((d) ^ ((b) & ((c) ^ (d)))) + words[i] + (constant); \
+    (a) = MD5_ROTATE((a), (shift)) + (b)
+
+#define MD5_GG(a, b, c, d, i, constant, shift) \
+    (a) += ((c) & ~(d)) + words[i] + (constant); \
+    (a) += (b) & (d); \
+    (a) = MD5_ROTATE((a), (shift)) + (b)
+
+#define MD5_HH(a, b, c, d, i, constant, shift) \
+    (a) += ((b) ^ (c) ^ (d)) + words[i] + (constant); \
+    (a) = MD5_ROTATE((a), (shift)) + (b)
+
+#define MD5_II(a, b, c, d, i, constant, shift) \
+    (a) += ((c) ^ ((b) | ~(d))) + words[i] + (constant); \
+    (a) = MD5_ROTATE((a), (shift)) + (b)
+
+
+/**
+ * Process 64 bytes blocks, the state being kept in registers over the steps.
+ *
+ * @param state     The md5 state to update.
+ * @param bytes     The blocks.
+ * @param nb_blocks The number of blocks.
+ */
+static void md5_process_blocks(uint32_t state[4], const uint8_t* bytes, uint32_t nb_blocks) {
+
+    for(; nb_blocks > 0; --nb_blocks, bytes += 64) {
+        uint32_t words[16];
+        uint32_t a = state[0];
+        uint32_t b = state[1];
+        uint32_t c = state[2];
+        uint32_t d = state[3];
+        int i = 0;
+
+        for(; i < 16; ++i)
+            words[i] = (uint32_t)bytes[i * 4] | ((uint32_t)bytes[i * 4 + 1] << 8) | ((uint32_t)bytes[i * 4 + 2] << 16) | ((uint32_t)bytes[i * 4 + 3] << 24);
+
+        MD5_STEPS(MD5_FF, MD5_GG, MD5_HH, MD5_II);
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+    }
+
+}
+
+#ifdef MD5_X86_KERNELS
+
+/**
+ * The same steps on vectors of computations, written with the MD5_V_*
+ * operations defined before each kernel. ones has all its bits set.
+ */
+#define MD5_VFF(a, b, c, d, i, constant, shift) \
+    (a) = MD5_V_ADD((a), MD5_V_ADD(MD5_V_XOR((d), MD5_V_AND((b), MD5_V_XOR((c), (d)))), MD5_V_ADD(words[i], MD5_V_SET1(constant)))); \
+    (a) = MD5_V_ADD(MD5_V_OR(MD5_V_SLLI((a), (shift)), MD5_V_SRLI((a), 32 - (shift))), (b))
+
+#define MD5_VGG(a, b, c, d, i, constant, shift) \
+    (a) = MD5_V_ADD((a), MD5_V_ADD(MD5_V_ANDNOT((d), (c)), MD5_V_ADD(words[i], MD5_V_SET1(constant)))); \
+    (a) = MD5_V_ADD((a), MD5_V_AND((b), (d))); \
+    (a) = MD5_V_ADD(MD5_V_OR(MD5_V_SLLI((a), (shift)), MD5_V_SRLI((a), 32 - (shift))), (b))
+
+#define MD5_VHH(a, b, c, d, i, constant, shift) \
+    (a) = MD5_V_ADD((a), MD5_V_ADD(MD5_V_XOR(MD5_V_XOR((b), (c)), (d)), MD5_V_ADD(words[i], MD5_V_SET1(constant)))); \
+    (a) = MD5_V_ADD(MD5_V_OR(MD5_V_SLLI((a), (shift)), MD5_V_SRLI((a), 32 - (shift))), (b))
+
+#define MD5_VII(a, b, c, d, i, constant, shift) \
+    (a) = MD5_V_ADD((a), MD5_V_ADD(MD5_V_XOR((c), MD5_V_OR((b), MD5_V_XOR((d), ones))), MD5_V_ADD(words[i], MD5_V_SET1(constant)))); \
+    (a) = MD5_V_ADD(MD5_V_OR(MD5_V_SLLI((a), (shift)), MD5_V_SRLI((a), 32 - (shift))), (b))
+
+#define MD5_V_ADD    _mm_add_epi32
+#define MD5_V_AND    _mm_and_si128
+#define MD5_V_ANDNOT _mm_andnot_si128
+#define MD5_V_OR     _mm_or_si128
+#define MD5_V_XOR    _mm_xor_si128
+#define MD5_V_SLLI   _mm_slli_epi32
+#define MD5_V_SRLI   _mm_srli_epi32
+#define MD5_V_SET1(constant) _mm_set1_epi32((int32_t)(constant))
+
+/**
+ * Process 64 bytes blocks of four computations at once, one per lane of SSE2
+ * vectors. The words of the blocks are transposed four by four from the
+ * computations into the lanes.
+ *
+ * @param states    The md5 states to update.
+ * @param blocks    The blocks of each computation.
+ * @param nb_blocks The number of blocks of each computation.
+ */
+__attribute__((target("sse2")))
+static void md5_process_blocks_sse2(uint32_t* states[4], const uint8_t* blocks[4], uint32_t nb_blocks) {
+
+    const uint8_t* bytes[4] = {blocks[0], blocks[1], blocks[2], blocks[3]};
+    uint32_t values[4][4];
+    __m128i ones = _mm_set1_epi32(-1);
+    __m128i a = _mm_set_epi32(states[3][0], states[2][0], states[1][0], states[0][0]);
+    __m128i b = _mm_set_epi32(states[3][1], states[2][1], states[1][1], states[0][1]);
+    __m128i c = _mm_set_epi32(states[3][2], states[2][2], states[1][2], states[0][2]);
+    __m128i d = _mm_set_epi32(states[3][3], states[2][3], states[1][3], states[0][3]);
+    int i = 0;
+    int j = 0;
+
+    for(; nb_blocks > 0; --nb_blocks) {
+        __m128i words[16];
+        __m128i previous_a = a;
+        __m128i previous_b = b;
+        __m128i previous_c = c;
+        __m128i previous_d = d;
+
+        for(i = 0; i < 4; ++i) {
+            __m128i low_01 = _mm_unpacklo_epi32(_mm_loadu_si128((const __m128i*)(bytes[0] + i * 16)), _mm_loadu_si128((const __m128i*)(bytes[1] + i * 16)));
+            __m128i low_23 = _mm_unpacklo_epi32(_mm_loadu_si128((const __m128i*)(bytes[2] + i * 16)), _mm_loadu_si128((const __m128i*)(bytes[3] + i * 16)));
+            __m128i high_01 = _mm_unpackhi_epi32(_mm_loadu_si128((const __m128i*)(bytes[0] + i * 16)), _mm_loadu_si128((const __m128i*)(bytes[1] + i * 16)));
+            __m128i high_23 = _mm_unpackhi_epi32(_mm_loadu_si128((const __m128i*)(bytes[2] + i * 16)), _mm_loadu_si128((const __m128i*)(bytes[3] + i * 16)));
+
+            words[i * 4] = _mm_unpacklo_epi64(low_01, low_23);
+            words[i * 4 + 1] = _mm_unpackhi_epi64(low_01, low_23);
+            words[i * 4 + 2] = _mm_unpacklo_epi64(high_01, high_23);
+            words[i * 4 + 3] = _mm_unpackhi_epi64(high_01, high_23);
+        }
+
+        MD5_STEPS(MD5_VFF, MD5_VGG, MD5_VHH, MD5_VII);
+
+        a = _mm_add_epi32(a, previous_a);
+        b = _mm_add_epi32(b, previous_b);
+        c = _mm_add_epi32(c, previous_c);
+        d = _mm_add_epi32(d, previous_d);
+
+        for(j = 0; j < 4; ++j)
+            bytes[j] += 64;
+    }
+
+    _mm_storeu_si128((__m128i*)values[0], a);
+    _mm_storeu_si128((__m128i*)values[1], b);
+    _mm_storeu_si128((__m128i*)values[2], c);
+    _mm_storeu_si128((__m128i*)values[3], d);
+
+    for(j = 0; j < 4; ++j)
+        for(i = 0; i < 4; ++i)
+            states[j][i] = values[i][j];
+
+}
+
+#undef MD5_V_ADD
+#undef MD5_V_AND
+#undef MD5_V_ANDNOT
+#undef MD5_V_OR
+#undef MD5_V_XOR
+#undef MD5_V_SLLI
+#undef MD5_V_SRLI
+#undef MD5_V_SET1
+
+#define MD5_V_ADD    _mm256_add_epi32
+#define MD5_V_AND    _mm256_and_si256
+#define MD5_V_ANDNOT _mm256_andnot_si256
+#define MD5_V_OR     _mm256_or_si256
+#define MD5_V_XOR    _mm256_xor_si256
+#define MD5_V_SLLI   _mm256_slli_epi32
+#define MD5_V_SRLI   _mm256_srli_epi32
+#define MD5_V_SET1(constant) _mm256_set1_epi32((int32_t)(constant))
+
+/**
+ * Same as md5_process_blocks_sse2 but for eight computations with AVX2
+ * vectors. The blocks of the computations i and i + 4 share the loads into the
+ * two halves of a vector so that the transposition within each half puts the
+ * computations in order.
+ */
+__attribute__((target("avx2")))
+static void md5_process_blocks_avx2(uint32_t* states[8], const uint8_t* blocks[8], uint32_t nb_blocks) {
+
+    const uint8_t* bytes[8] = {blocks[0], blocks[1], blocks[2], blocks[3], blocks[4], blocks[5], blocks[6], blocks[7]};
+    uint32_t values[4][8];
+    __m256i ones = _mm256_set1_epi32(-1);
+    __m256i a = _mm256_set_epi32(states[7][0], states[6][0], states[5][0], states[4][0], states[3][0], states[2][0], states[1][0], states[0][0]);
+    __m256i b = _mm256_set_epi32(states[7][1], states[6][1], states[5][1], states[4][1], states[3][1], states[2][1], states[1][1], states[0][1]);
+    __m256i c = _mm256_set_epi32(states[7][2], states[6][2], states[5][2], states[4][2], states[3][2], states[2][2], states[1][2], states[0][2]);
+    __m256i d = _mm256_set_epi32(states[7][3], states[6][3], states[5][3], states[4][3], states[3][3], states[2][3], states[1][3], states[0][3]);
+    int i = 0;
+    int j = 0;
+
+    for(; nb_blocks > 0; --nb_blocks) {
+        __m256i words[16];
+        __m256i previous_a = a;
+        __m256i previous_b = b;
+        __m256i previous_c = c;
+        __m256i previous_d = d;
+
+        for(i = 0; i < 4; ++i) {
+            __m256i rows[4];
+            __m256i low_01;
+            __m256i low_23;
+            __m256i high_01;
+            __m256i high_23;
+
+            for(j = 0; j < 4; ++j)
+                rows[j] = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(bytes[j] + i * 16))), _mm_loadu_si128((const __m128i*)(bytes[j + 4] + i * 16)), 1);
+
+            low_01 = _mm256_unpacklo_epi32(rows[0], rows[1]);
+            low_23 = _mm256_unpacklo_epi32(rows[2], rows[3]);
+            high_01 = _mm256_unpackhi_epi32(rows[0], rows[1]);
+            high_23 = _mm256_unpackhi_epi32(rows[2], rows[3]);
+
+            words[i * 4] = _mm256_unpacklo_epi64(low_01, low_23);
+            words[i * 4 + 1] = _mm256_unpackhi_epi64(low_01, low_23);
+            words[i * 4 + 2] = _mm256_unpacklo_epi64(high_01, high_23);
+            words[i * 4 + 3] = _mm256_unpackhi_epi64(high_01, high_23);
+        }
+
+        MD5_STEPS(MD5_VFF, MD5_VGG, MD5_VHH, MD5_VII);
+
+        a = _mm256_add_epi32(a, previous_a);
+        b = _mm256_add_epi32(b, previous_b);
+        c = _mm256_add_epi32(c, previous_c);
+        d = _mm256_add_epi32(d, previous_d);
+
+        for(j = 0; j < 8; ++j)
+            bytes[j] += 64;
+    }
+
+    _mm256_storeu_si256((__m256i*)values[0], a);
+    _mm256_storeu_si256((__m256i*)values[1], b);
+    _mm256_storeu_si256((__m256i*)values[2], c);
+    _mm256_storeu_si256((__m256i*)values[3], d);
+
+    for(j = 0; j < 8; ++j)
+        for(i = 0; i < 4; ++i)
+            states[j][i] = values[i][j];
+
+}
+
+#endif
+
+
+/**
+ * Process the same number of blocks of several computations, with the widest
+ * vectors available when there are at least two of them. The lanes left
+ * unused by the last computations are filled with the blocks of the first one
+ * and their result dropped.
+ *
+ * @param md5_contexts The computations.
+ * @param blocks       The blocks of each computation.
+ * @param nb_lanes     The number of computations.
+ * @param nb_blocks    The number of blocks of each computation.
+ */
+static void md5_process_lanes(md5_context_t* md5_contexts[], const uint8_t* blocks[], uint8_t nb_lanes, uint32_t nb_blocks) {
+
+    uint8_t i = 0;
+
+#ifdef MD5_X86_KERNELS
+    uint8_t nb_vector_lanes = (g_has_avx2 && (nb_lanes > 4)) ? 8 : (g_has_sse2 ? 4 : 0);
+
+    if((nb_lanes > 1) && (nb_vector_lanes > 0)) {
+        uint32_t unused_states[MD5_MAX_LANES][4] = {{0}};
+
+        for(; i < nb_lanes; i += nb_vector_lanes) {
+            uint32_t* states[MD5_MAX_LANES];
+            const uint8_t* lane_blocks[MD5_MAX_LANES];
+            uint8_t j = 0;
+
+            for(; j < nb_vector_lanes; ++j) {
+                if((i + j) < nb_lanes) {
+                    states[j] = md5_contexts[i + j]->state;
+                    lane_blocks[j] = blocks[i + j];
+                } else {
+                    states[j] = unused_states[j];
+                    lane_blocks[j] = blocks[i];
+                }
+            }
+
+            if(nb_vector_lanes == 8)
+                md5_process_blocks_avx2(states, lane_blocks, nb_blocks);
+            else
+                md5_process_blocks_sse2(states, lane_blocks, nb_blocks);
+        }
+
+        return;
+    }
+#endif
+
+    for(; i < nb_lanes; ++i)
+        md5_process_blocks(md5_contexts[i]->state, blocks[i], nb_blocks);
+
+}
+
+
+/**
+ * Hash together the waiting blocks of the computations having at least a given
+ * number of them, as many blocks as the computation having the less of them
+ * has. The remaining blocks are moved to the beginning of the buffers.
+ *
+ * @param md5_lanes     The computations hashed in lanes.
+ * @param min_nb_blocks The minimum number of waiting blocks of a computation
+ *                      to be hashed, at least one.
+ */
+static void md5_hash_lanes(md5_lanes_t* md5_lanes, uint32_t min_nb_blocks) {
+
+    md5_context_t* md5_contexts[MD5_MAX_LANES];
+    const uint8_t* blocks[MD5_MAX_LANES];
+    uint32_t nb_blocks = MD5_NB_LANE_BLOCKS;
+    uint8_t nb_lanes = 0;
+    uint8_t i = 0;
+
+    for(; i < md5_lanes->nb_lanes; ++i) {
+        md5_context_t* md5_context = md5_lanes->md5_contexts[i];
+
+        if((md5_context->lanes != NULL) && (md5_context->nb_lane_blocks >= min_nb_blocks)) {
+            md5_contexts[nb_lanes] = md5_context;
+            blocks[nb_lanes++] = md5_context->lane_blocks;
+            if(md5_context->nb_lane_blocks < nb_blocks)
+                nb_blocks = md5_context->nb_lane_blocks;
+        }
+    }
+
+    if(nb_lanes == 0)
+        return;
+
+    md5_process_lanes(md5_contexts, blocks, nb_lanes, nb_blocks);
+
+    for(i = 0; i < nb_lanes; ++i) {
+        md5_contexts[i]->nb_lane_blocks -= nb_blocks;
+        memmove(md5_contexts[i]->lane_blocks, md5_contexts[i]->lane_blocks + (nb_blocks << 6), md5_contexts[i]->nb_lane_blocks << 6);
+    }
+
+}
+
+
+/**
+ * Hash whole blocks of a computation, either right away or once there are
+ * enough blocks waiting in the other lanes if it is hashed in lanes. When its
+ * buffer gets full, the computations having at least a quarter of a buffer
+ * are hashed together.
+ *
+ * @param md5_context The md5 computation.
+ * @param bytes       The blocks.
+ * @param nb_blocks   The number of blocks.
+ */
+static void md5_hash_blocks(md5_context_t* md5_context, const uint8_t* bytes, uint32_t nb_blocks) {
+
+    if(md5_context->lanes == NULL) {
+        md5_process_blocks(md5_context->state, bytes, nb_blocks);
+        return;
+    }
+
+    while(nb_blocks > 0) {
+        uint32_t nb_free_blocks = MD5_NB_LANE_BLOCKS - md5_context->nb_lane_blocks;
+        uint32_t nb_copied_blocks = nb_blocks < nb_free_blocks ? nb_blocks : nb_free_blocks;
+
+        memcpy(md5_context->lane_blocks + (md5_context->nb_lane_blocks << 6), bytes, nb_copied_blocks << 6);
+        md5_context->nb_lane_blocks += nb_copied_blocks;
+        bytes += nb_copied_blocks << 6;
+        nb_blocks -= nb_copied_blocks;
+
+        if(md5_context->nb_lane_blocks == MD5_NB_LANE_BLOCKS)
+            md5_hash_lanes(md5_context->lanes, MD5_NB_LANE_BLOCKS / 4);
+    }
+
+}
+
+
+/**
+ * Start an md5 computation.
+ *
+ * @param md5_context The md5 computation to start.
+ */
+void md5_init(md5_context_t* md5_context) {
+
+    md5_context->state[0] = 0x67452301u;
+    md5_context->state[1] = 0xEFCDAB89u;
+    md5_context->state[2] = 0x98BADCFEu;
+    md5_context->state[3] = 0x10325476u;
+    md5_context->nb_bytes[0] = 0;
+    md5_context->nb_bytes[1] = 0;
+    md5_context->lanes = NULL;
+    md5_context->lane_blocks = NULL;
+    md5_context->nb_lane_blocks = 0;
+
+}
+
+
+/**
+ * Hash more bytes.
+ *
+ * @param md5_context The md5 computation.
+ * @param bytes       The bytes to hash.
+ * @param nb_bytes    The number of bytes.
+ */
+void md5_update(md5_context_t* md5_context, const uint8_t* bytes, uint32_t nb_bytes) {
+
+    uint32_t block_size = md5_context->nb_bytes[0] & 63;
+
+    md5_context->nb_bytes[0] += nb_bytes;
+    if(md5_context->nb_bytes[0] < nb_bytes)
+        ++md5_context->nb_bytes[1];
+
+    /* Complete the pending block first. */
+    if(block_size > 0) {
+        uint32_t nb_missing_bytes = 64 - block_size;
+
+        if(nb_bytes < nb_missing_bytes) {
+            memcpy(md5_context->block + block_size, bytes, nb_bytes);
+            return;
+        }
+
+        memcpy(md5_context->block + block_size, bytes, nb_missing_bytes);
+        md5_hash_blocks(md5_context, md5_context->block, 1);
+        bytes += nb_missing_bytes;
+        nb_bytes -= nb_missing_bytes;
+    }
+
+    /* Whole blocks are processed from where they are. */
+    md5_hash_blocks(md5_context, bytes, nb_bytes >> 6);
+    memcpy(md5_context->block, bytes + (nb_bytes & ~63u), nb_bytes & 63);
+
+}
+
+
+/**
+ * Hash decoded samples the way the md5 of the stream info is computed, that
+ * is interleaved, signed and little endian on the smallest number of whole
+ * bytes holding a sample.
+ *
+ * @param md5_context     The md5 computation.
+ * @param samples         The blocks of samples, one per channel.
+ * @param stride          The number of samples between the beginning of two
+ *                        consecutive channel blocks.
+ * @param nb_channels     The number of channels.
+ * @param bits_per_sample The sample size in bits.
+ * @param nb_samples      The number of samples per channel to hash.
+ */
+void md5_update_samples(md5_context_t* md5_context, const int32_t* samples, uint32_t stride, uint8_t nb_channels, uint8_t bits_per_sample, uint16_t nb_samples) {
+
+    uint8_t buffer[MD5_SAMPLE_BUFFER_SIZE];
+    uint8_t nb_bytes_per_sample = (bits_per_sample + 7) >> 3;
+    uint16_t nb_samples_per_chunk = MD5_SAMPLE_BUFFER_SIZE / (nb_bytes_per_sample * nb_channels);
+    uint16_t crt_sample = 0;
+
+    while(crt_sample < nb_samples) {
+        uint16_t last_sample = (nb_samples - crt_sample) > nb_samples_per_chunk ? crt_sample + nb_samples_per_chunk : nb_samples;
+        uint8_t* byte = buffer;
+        uint16_t i = crt_sample;
+
+        /* The usual 16 bits stereo has its own loop. */
+        if((nb_bytes_per_sample == 2) && (nb_channels == 2)) {
+            for(; i < last_sample; ++i, byte += 4) {
+                uint32_t left = (uint32_t)samples[i];
+                uint32_t right = (uint32_t)samples[stride + i];
+
+                byte[0] = left;
+                byte[1] = left >> 8;
+                byte[2] = right;
+                byte[3] = right >> 8;
+            }
+        } else {
+            for(; i < last_sample; ++i) {
+                uint8_t channel_nb = 0;
+
+                for(; channel_nb < nb_channels; ++channel_nb) {
+                    uint32_t sample = (uint32_t)samples[channel_nb * stride + i];
+
+                    switch(nb_bytes_per_sample) {
+                        case 4:
+                            byte[3] = sample >> 24;
+                            /* Falls through. */
+                        case 3:
+                            byte[2] = sample >> 16;
+                            /* Falls through. */
+                        case 2:
+                            byte[1] = sample >> 8;
+                            /* Falls through. */
+                        default:
+                            byte[0] = sample;
+                    }
+
+                    byte += nb_bytes_per_sample;
+                }
+            }
+        }
+
+        md5_update(md5_context, buffer, byte - buffer);
+        crt_sample = last_sample;
+    }
+
+}
+
+
+/**
+ * End an md5 computation.
+ *
+ * @param md5_context The md5 computation to end.
+ * @param md5         The md5 of the hashed bytes is put there.
+ */
+void md5_final(md5_context_t* md5_context, uint8_t md5[16]) {
+
+    uint8_t padding[72] = {0x80};
+    uint32_t nb_bits_low = md5_context->nb_bytes[0] << 3;
+    uint32_t nb_bits_high = (md5_context->nb_bytes[1] << 3) | (md5_context->nb_bytes[0] >> 29);
+    uint32_t nb_padding_bytes = ((md5_context->nb_bytes[0] & 63) < 56) ? 56 - (md5_context->nb_bytes[0] & 63) : 120 - (md5_context->nb_bytes[0] & 63);
+    int i = 0;
+
+    /* The waiting blocks are hashed along the ones of the computations having
+       as many and the rest is hashed on its own. */
+    if(md5_context->lanes != NULL) {
+        if(md5_context->nb_lane_blocks > 0)
+            md5_hash_lanes(md5_context->lanes, md5_context->nb_lane_blocks);
+        md5_context->lanes = NULL;
+    }
+
+    /* The length in bits comes after the padding. */
+    for(; i < 4; ++i) {
+        padding[nb_padding_bytes + i] = nb_bits_low >> (i * 8);
+        padding[nb_padding_bytes + 4 + i] = nb_bits_high >> (i * 8);
+    }
+
+    md5_update(md5_context, padding, nb_padding_bytes + 8);
+
+    for(i = 0; i < 4; ++i) {
+        md5[i * 4] = md5_context->state[i];
+        md5[i * 4 + 1] = md5_context->state[i] >> 8;
+        md5[i * 4 + 2] = md5_context->state[i] >> 16;
+        md5[i * 4 + 3] = md5_context->state[i] >> 24;
+    }
+
+}
+
+
+/**
+ * Start md5 computations hashed together in lanes. The blocks of each one are
+ * gathered until there are enough of them in the other lanes too. The
+ * computations are then updated and ended as usual.
+ *
+ * @param md5_lanes    The lanes to start.
+ * @param md5_contexts The computations to start, one per lane.
+ * @param nb_lanes     The number of computations, at most MD5_MAX_LANES.
+ *
+ * @return Return 0 if successful, -1 else.
+ */
+int md5_init_lanes(md5_lanes_t* md5_lanes, md5_context_t* md5_contexts, uint8_t nb_lanes) {
+
+    uint8_t i = 0;
+
+#ifdef MD5_X86_KERNELS
+    __builtin_cpu_init();
+    g_has_sse2 = __builtin_cpu_supports("sse2") ? 1 : 0;
+    g_has_avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+#endif
+
+    md5_lanes->nb_lanes = 0;
+
+    for(; i < nb_lanes; ++i) {
+        md5_init(md5_contexts + i);
+
+        md5_contexts[i].lane_blocks = (uint8_t*)malloc(sizeof(uint8_t) * MD5_NB_LANE_BLOCKS * 64);
+        if(md5_contexts[i].lane_blocks == NULL) {
+            perror("An error occured while allocating the md5 lane blocks");
+            md5_free_lanes(md5_lanes);
+            return -1;
+        }
+
+        md5_contexts[i].lanes = md5_lanes;
+        md5_lanes->md5_contexts[i] = md5_contexts + i;
+        ++md5_lanes->nb_lanes;
+    }
+
+    return 0;
+
+}
+
+
+/**
+ * Free the buffers of the computations hashed in lanes.
+ *
+ * @param md5_lanes The lanes to free.
+ */
+void md5_free_lanes(md5_lanes_t* md5_lanes) {
+
+    uint8_t i = 0;
+
+    for(; i < md5_lanes->nb_lanes; ++i) {
+        free(md5_lanes->md5_contexts[i]->lane_blocks);
+        md5_lanes->md5_contexts[i]->lane_blocks = NULL;
+        md5_lanes->md5_contexts[i]->lanes = NULL;
+    }
+
+    md5_lanes->nb_lanes = 0;
+
+}
@@ -0,0 +1,104 @@
+/**
+ * Copyright © 2013 Jean-François Hren <jfhren@gmail.com>
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+#ifndef MD5_H
+#define MD5_H
+#include <stdint.h>
+
+/**
+ * The maximum number of md5 computations hashed together in lanes.
+ */
+#define MD5_MAX_LANES 8
+
+struct md5_lanes_t;
+
+/**
+ * The state of an md5 computation.
+ */
+typedef struct md5_context_t {
+    uint32_t state[4];          /**< The md5 of the processed blocks. */
+    uint32_t nb_bytes[2];       /**< The number of hashed bytes, low word
+                                     first. */
+    uint8_t block[64];          /**< The bytes of the incomplete block. */
+    struct md5_lanes_t* lanes;  /**< The lanes the computation is hashed in
+                                     with others. NULL if it is hashed on its
+                                     own. */
+    uint8_t* lane_blocks;       /**< The whole blocks waiting to be hashed
+                                     with the ones of the other lanes. */
+    uint32_t nb_lane_blocks;    /**< The number of waiting blocks. */
+} md5_context_t;
+
+/**
+ * Independent md5 computations whose blocks are hashed together, a lane of
+ * SSE2 or AVX2 vectors each, instead of one after the other.
+ */
+typedef struct md5_lanes_t {
+    md5_context_t* md5_contexts[MD5_MAX_LANES]; /**< The computations. */
+    uint8_t nb_lanes;                           /**< The number of
+                                                     computations. */
+} md5_lanes_t;
+
+/**
+ * Start an md5 computation.
+ *
+ * @param md5_context The md5 computation to start.
+ */
+void md5_init(md5_context_t* md5_context);
+
+/**
+ * Hash more bytes.
+ *
+ * @param md5_context The md5 computation.
+ * @param bytes       The bytes to hash.
+ * @param nb_bytes    The number of bytes.
+ */
+void md5_update(md5_context_t* md5_context, const uint8_t* bytes, uint32_t nb_bytes);
+
+/**
+ * Hash decoded samples the way the md5 of the stream info is computed, that
+ * is interleaved, signed and little endian on the smallest number of whole
+ * bytes holding a sample.
+ *
+ * @param md5_context     The md5 computation.
+ * @param samples         The blocks of samples, one per channel.
+ * @param stride          The number of samples between the beginning of two
+ *                        consecutive channel blocks.
+ * @param nb_channels     The number of channels.
+ * @param bits_per_sample The sample size in bits.
+ * @param nb_samples      The number of samples per channel to hash.
+ */
+void md5_update_samples(md5_context_t* md5_context, const int32_t* samples, uint32_t stride, uint8_t nb_channels, uint8_t bits_per_sample, uint16_t nb_samples);
+
+/**
+ * End an md5 computation. If it is hashed in lanes, it leaves them.
+ *
+ * @param md5_context The md5 computation to end.
+ * @param md5         The md5 of the hashed bytes is put there.
+ */
+void md5_final(md5_context_t* md5_context, uint8_t md5[16]);
+
+/**
+ * Start md5 computations hashed together in lanes. The blocks of each one are
+ * gathered until there are enough of them in the other lanes too. The
+ * computations are then updated and ended as usual.
+ *
+ * @param md5_lanes    The lanes to start.
+ * @param md5_contexts The computations to start, one per lane.
+ * @param nb_lanes     The number of computations, at most MD5_MAX_LANES.
+ *
+ * @return Return 0 if successful, -1 else.
+ */
+int md5_init_lanes(md5_lanes_t* md5_lanes, md5_context_t* md5_contexts, uint8_t nb_lanes);
+
+/**
+ * Free the buffers of the computations hashed in lanes.
+ *
+ * @param md5_lanes The lanes to free.
+ */
+void md5_free_lanes(md5_lanes_t* md5_lanes);
+
+#endif
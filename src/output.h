@@ -7,10 +7,20 @@
 
 #include <stdint.h>
 #include "decode_flac.h"
+#include "md5.h"
 
 #ifndef OUTPUT_H
 #define OUTPUT_H
 
+/**
+ * What to output in place of the samples of the damaged frames skipped when
+ * resynchronising the decoding: nothing, silence or the previous frame
+ * repeated.
+ */
+#define CONCEAL_OFF     0
+#define CONCEAL_SILENCE 1
+#define CONCEAL_REPEAT  2
+
 struct data_output_t;
 
 /**
@@ -23,28 +33,60 @@ struct data_output_t;
  */
 typedef int(*dump_func_t)(struct data_output_t* data_output, int nb_bits);
 
+/**
+ * Pack interleaved samples from per channel blocks of decoded samples into the
+ * output buffer. There should be room for all of them.
+ *
+ * @param data_output     The output buffer is there.
+ * @param samples         The blocks of samples, one per channel.
+ * @param stride          The number of samples between the beginning of two
+ *                        consecutive channel blocks.
+ * @param nb_channels     The number of channels.
+ * @param bits_per_sample The sample size in bits.
+ * @param nb_samples      The number of samples per channel to pack, at least
+ *                        one.
+ */
+typedef void(*pack_func_t)(struct data_output_t* data_output, const int32_t* samples, uint32_t stride, uint8_t nb_channels, uint8_t bits_per_sample, uint16_t nb_samples);
+
 
 /**
  * Represent the output stream.
  */
 typedef struct data_output_t {
     dump_func_t dump_func;      /**< Function used to dump the buffer. */
-    uint8_t* buffer;            /**< Used to buffer written data. */
+    pack_func_t pack_func;      /**< Function used to pack samples into the
+                                     buffer, chosen for the current stream. */
+    pack_func_t decorrelate_pack_funcs[3];/**< If not NULL, the functions
+                                               used to pack the LEFT_SIDE,
+                                               RIGHT_SIDE and MID_SIDE frames
+                                               of the current stream while
+                                               decorrelating them, the decoding
+                                               leaving them correlated. */
+    uint8_t* buffer;            /**< Used to buffer written data. NULL for a
+                                     null output. */
     int size;                   /**< Size of the buffer. */
     int write_size;             /**< Size of the written data in the buffer. */
-    int starting_position;      /**< Where does the current frame start in the
-                                     buffer. */
-    uint8_t starting_shift;     /**< What was the current shift before the
-                                     current frame. */
     int position;               /**< The current write position in the buffer. */
     uint8_t shift;              /**< The current bit shift inside the current
                                      byte. */
     uint8_t is_little_endian;   /**< Should the output be little endian style
                                      or not (that is big endian). */
     uint8_t is_signed;          /**< Should the output be signed or not. */
+    uint32_t nb_samples_to_skip;/**< The number of decoded samples per channel
+                                     to drop before outputing any, set when
+                                     seeking inside a frame. */
+    sample_number_t nb_samples_to_output;/**< The number of samples per channel
+                                              still to output if is_limited. */
+    uint8_t is_limited;         /**< Should the decoding stop once
+                                     nb_samples_to_output samples are
+                                     outputed? */
+    md5_context_t* md5_context; /**< If not NULL, the outputed samples are
+                                     hashed there whatever the output
+                                     format. */
+    uint8_t concealment;        /**< One of the CONCEAL_* values. */
 } data_output_t;
 
-#define DATA_OUTPUT_INIT() {.dump_func = NULL, .buffer = NULL, .size = 0, .write_size = 0, .starting_position = 0, .starting_shift = 0, .position = 0, .shift = 0, .is_little_endian = 0, .is_signed = 0}
+#define DATA_OUTPUT_INIT() {.dump_func = NULL, .pack_func = NULL, .decorrelate_pack_funcs = {NULL, NULL, NULL}, .buffer = NULL, .size = 0, .write_size = 0, .position = 0, .shift = 0, .is_little_endian = 0, .is_signed = 0, .nb_samples_to_skip = 0, .nb_samples_to_output = 0, .is_limited = 0, .md5_context = NULL, .concealment = CONCEAL_OFF}
 
 /**
  * Init the output to a file descriptor.
@@ -60,29 +102,49 @@ typedef struct data_output_t {
  */
 int init_data_output_to_fd(data_output_t* data_output, int fd, int buffer_size, uint8_t is_little_endian, uint8_t is_signed, uint8_t can_pause);
 
+/**
+ * Init the output to nothing. The samples are decoded, hashed if asked for and
+ * dropped without being packed into a buffer nor written anywhere.
+ *
+ * @param data_output The structure representing the output to fill out.
+ *
+ * @return Return 0 if successful, -1 else.
+ */
+int init_data_output_to_null(data_output_t* data_output);
+
 /**
  * We suppose that if value represent a signed integer then it is using two's
  * complement representation.  For now, we just fill the whole most significant
- * (64 - size) bis with 1 if the size-th bit is one.
+ * (32 - size) bis with 1 if the size-th bit is one. The mask is shifted in two
+ * steps so that a size of 32 does not shift by the width of the type.
+ *
+ * @param value The value to convert.
+ * @param size The number of bits making up the value.
+ *
+ * @return Return the converted value as a signed one on 32 bits.
+ */
+static inline int32_t convert_to_signed(uint32_t value, uint8_t size) {
+
+    return value & (((uint32_t)1) << (size - 1)) ? (int32_t)(((((uint32_t)0xFFFFFFFFu) << (size - 1)) << 1) | value) : (int32_t)value;
+
+}
+
+#ifdef DECODE_WIDE_SIDE
+/**
+ * Same as convert_to_signed but on 64 bits for the 33 bits side channel of 32
+ * bits streams.
  *
  * @param value The value to convert.
  * @param size The number of bits making up the value.
  *
  * @return Return the converted value as a signed one on 64 bits.
  */
-static inline DECODE_TYPE convert_to_signed(DECODE_UTYPE value, uint8_t size) {
-
-#ifdef DECODE_TYPE_16_BITS
-    return value & (((DECODE_UTYPE)1) << (size - 1)) ? (((DECODE_UTYPE)0xFFFFu) << size) | value : value;
-#elif defined DECODE_TYPE_32_BITS
-    return value & (((DECODE_UTYPE)1) << (size - 1)) ? (((DECODE_UTYPE)0xFFFFFFFFu) << size) | value : value;
-#elif defined DECODE_TYPE_64_BITS
-    return value & (((DECODE_UTYPE)1) << (size - 1)) ? (((DECODE_UTYPE)0xFFFFFFFFFFFFFFFFull) << size) | value : value;
-#else
-    #error "Should not happen but kinda did."
-#endif
+static inline int64_t convert_to_signed_wide(uint64_t value, uint8_t size) {
+
+    return value & (((uint64_t)1) << (size - 1)) ? (int64_t)((((uint64_t)0xFFFFFFFFFFFFFFFFull) << size) | value) : (int64_t)value;
 
 }
+#endif
 
 /**
  * Dump nb_bytes bytes from the output buffer to the output file descriptor
@@ -101,22 +163,41 @@ static inline int dump_buffer(data_output_t* data_output, int nb_bytes) {
 }
 
 /**
- * Output a sample while taking care of its size, channel number, channel
- * assignement and buffer remaining space. A sample is not added to the buffer
- * if there is not enough space for it whole.
- *
- * @param data_output         The output buffer is there.
- * @param sample              The sample to output.
- * @param sample_size         The sample size in bits.
- * @param channel_assignement The channel assignement of the sample (mono,
- *                            stereo, whatever...) @param channel_nb The channel
- *                            number of this sample w.r.t. the channel
- *                            assignement.
- * @param channel_nb          The channel number to which appertains the sample.
- *
- * @return Return 1 if successful, 0 if the sample could not be put in the
- *         buffer, -1 else.
+ * Dump everything written so far in the output buffer.
+ *
+ * @param data_output The output buffer is there.
+ *
+ * @return Return 0 if successful, -1 else.
+ */
+static inline int flush_buffer(data_output_t* data_output) {
+
+    int nb_bits = (data_output->position << 3) + data_output->shift;
+
+    if(nb_bits < 8)
+        return 0;
+
+    return dump_buffer(data_output, nb_bits);
+
+}
+
+/**
+ * Output interleaved samples from per channel blocks of decoded samples while
+ * taking care of the buffer remaining space. Samples are outputed through the
+ * given pack function as long as there is room in the buffer for all the
+ * channels of a sample.
+ *
+ * @param data_output     The output buffer is there.
+ * @param pack_func       The pack function of the stream or of the frame.
+ * @param samples         The blocks of samples, one per channel.
+ * @param stride          The number of samples between the beginning of two
+ *                        consecutive channel blocks.
+ * @param nb_channels     The number of channels.
+ * @param bits_per_sample The sample size in bits.
+ * @param nb_samples      The number of samples per channel to output.
+ *
+ * @return Return the number of outputed samples per channel which is less than
+ *         nb_samples if the buffer got full.
  */
-int put_shifted_bits(data_output_t* data_output, DECODE_UTYPE sample, uint8_t sample_size, uint8_t channel_assignement, uint8_t channel_nb);
+uint16_t put_samples(data_output_t* data_output, pack_func_t pack_func, const int32_t* samples, uint32_t stride, uint8_t nb_channels, uint8_t bits_per_sample, uint16_t nb_samples);
 
 #endif
@@ -0,0 +1,793 @@
+/**
+ * Copyright © 2013 Jean-François Hren <jfhren@gmail.com>
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+#include <stdint.h>
+
+#include "pack.h"
+
+/**
+ * The vectorised kernels are only built for x86 with a compiler supporting
+ * per function target. They can be left out with DISALLOW_SIMD.
+ */
+#if !defined DISALLOW_SIMD && defined __GNUC__ && (defined __x86_64__ || defined __i386__)
+    #define PACK_X86_KERNELS
+    #include <immintrin.h>
+#endif
+
+#ifdef PACK_X86_KERNELS
+static uint8_t g_has_avx2 = 0;
+#endif
+
+/**
+ * Go through the samples in output order, that is interleaved, with sample
+ * being the current one already turned unsigned if needed.
+ */
+#define FOR_EACH_SAMPLE(...) \
+    do { \
+        uint16_t sample_nb = 0; \
+        for(; sample_nb < nb_samples; ++sample_nb) { \
+            const int32_t* channel_sample = samples + sample_nb; \
+            uint8_t channel_nb = 0; \
+            for(; channel_nb < nb_channels; ++channel_nb, channel_sample += stride) { \
+                uint32_t sample = (uint32_t)*channel_sample ^ offset; \
+                __VA_ARGS__ \
+            } \
+        } \
+    } while(0)
+
+/**
+ * Pack samples one at a time for any number of channels and any supported
+ * sample size. The 12 and 20 bits samples are packed on a nibble boundary
+ * every other sample.
+ */
+static void pack_generic(data_output_t* data_output, const int32_t* samples, uint32_t stride, uint8_t nb_channels, uint8_t bits_per_sample, uint16_t nb_samples) {
+
+    uint8_t* buffer = data_output->buffer;
+    uint32_t position = data_output->position;
+    uint8_t shift = data_output->shift;
+    uint32_t offset = data_output->is_signed ? 0 : ((uint32_t)1) << (bits_per_sample - 1);
+
+    switch(bits_per_sample) {
+#ifdef DECODE_8_BITS
+        case 8:
+            FOR_EACH_SAMPLE(
+                buffer[position++] = sample & 0xFF;
+            );
+            break;
+#endif
+#ifdef DECODE_12_BITS
+        case 12:
+            if(data_output->is_little_endian) {
+                FOR_EACH_SAMPLE(
+                    if(shift == 0) {
+                        buffer[position] = sample & 0xFF;
+                        buffer[position + 1] = (sample >> 4) & 0xF0;
+                        position += 1;
+                        shift = 4;
+                    } else {
+                        buffer[position] = (buffer[position] & 0xF0) | ((sample >> 4) & 0x0F);
+                        buffer[position + 1] = ((sample & 0x0F) << 4) | ((sample >> 8) & 0x0F);
+                        position += 2;
+                        shift = 0;
+                    }
+                );
+            } else {
+                FOR_EACH_SAMPLE(
+                    if(shift == 0) {
+                        buffer[position] = (sample >> 4) & 0xFF;
+                        buffer[position + 1] = (sample << 4) & 0xF0;
+                        position += 1;
+                        shift = 4;
+                    } else {
+                        buffer[position] = (buffer[position] & 0xF0) | ((sample >> 8) & 0x0F);
+                        buffer[position + 1] = sample & 0xFF;
+                        position += 2;
+                        shift = 0;
+                    }
+                );
+            }
+            break;
+#endif
+#ifdef DECODE_16_BITS
+        case 16:
+            if(data_output->is_little_endian) {
+                FOR_EACH_SAMPLE(
+                    buffer[position] = sample & 0xFF;
+                    buffer[position + 1] = (sample >> 8) & 0xFF;
+                    position += 2;
+                );
+            } else {
+                FOR_EACH_SAMPLE(
+                    buffer[position] = (sample >> 8) & 0xFF;
+                    buffer[position + 1] = sample & 0xFF;
+                    position += 2;
+                );
+            }
+            break;
+#endif
+#ifdef DECODE_20_BITS
+        case 20:
+            if(data_output->is_little_endian) {
+                FOR_EACH_SAMPLE(
+                    if(shift == 0) {
+                        buffer[position] = sample & 0xFF;
+                        buffer[position + 1] = (sample >> 8) & 0xFF;
+                        buffer[position + 2] = (sample >> 12) & 0xF0;
+                        position += 2;
+                        shift = 4;
+                    } else {
+                        buffer[position] = (buffer[position] & 0xF0) | ((sample >> 4) & 0x0F);
+                        buffer[position + 1] = ((sample & 0x0F) << 4) | ((sample >> 12) & 0x0F);
+                        buffer[position + 2] = ((sample >> 4) & 0xF0) | ((sample >> 16) & 0x0F);
+                        position += 3;
+                        shift = 0;
+                    }
+                );
+            } else {
+                FOR_EACH_SAMPLE(
+                    if(shift == 0) {
+                        buffer[position] = (sample >> 12) & 0xFF;
+                        buffer[position + 1] = (sample >> 4) & 0xFF;
+                        buffer[position + 2] = (sample << 4) & 0xF0;
+                        position += 2;
+                        shift = 4;
+                    } else {
+                        buffer[position] = (buffer[position] & 0xF0) | ((sample >> 16) & 0x0F);
+                        buffer[position + 1] = (sample >> 8) & 0xFF;
+                        buffer[position + 2] = sample & 0xFF;
+                        position += 3;
+                        shift = 0;
+                    }
+                );
+            }
+            break;
+#endif
+#ifdef DECODE_24_BITS
+        case 24:
+            if(data_output->is_little_endian) {
+                FOR_EACH_SAMPLE(
+                    buffer[position] = sample & 0xFF;
+                    buffer[position + 1] = (sample >> 8) & 0xFF;
+                    buffer[position + 2] = (sample >> 16) & 0xFF;
+                    position += 3;
+                );
+            } else {
+                FOR_EACH_SAMPLE(
+                    buffer[position] = (sample >> 16) & 0xFF;
+                    buffer[position + 1] = (sample >> 8) & 0xFF;
+                    buffer[position + 2] = sample & 0xFF;
+                    position += 3;
+                );
+            }
+            break;
+#endif
+#ifdef DECODE_32_BITS
+        case 32:
+            if(data_output->is_little_endian) {
+                FOR_EACH_SAMPLE(
+                    buffer[position] = sample & 0xFF;
+                    buffer[position + 1] = (sample >> 8) & 0xFF;
+                    buffer[position + 2] = (sample >> 16) & 0xFF;
+                    buffer[position + 3] = (sample >> 24) & 0xFF;
+                    position += 4;
+                );
+            } else {
+                FOR_EACH_SAMPLE(
+                    buffer[position] = (sample >> 24) & 0xFF;
+                    buffer[position + 1] = (sample >> 16) & 0xFF;
+                    buffer[position + 2] = (sample >> 8) & 0xFF;
+                    buffer[position + 3] = sample & 0xFF;
+                    position += 4;
+                );
+            }
+            break;
+#endif
+    }
+
+    data_output->position = position;
+    data_output->shift = shift;
+
+}
+
+#undef FOR_EACH_SAMPLE
+
+#ifdef DECODE_16_BITS
+/**
+ * Store a 16 bits sample already turned unsigned if needed.
+ */
+static inline void store_16_bits(uint8_t* bytes, uint32_t sample, uint8_t is_little_endian) {
+
+    if(is_little_endian) {
+        bytes[0] = sample & 0xFF;
+        bytes[1] = (sample >> 8) & 0xFF;
+    } else {
+        bytes[0] = (sample >> 8) & 0xFF;
+        bytes[1] = sample & 0xFF;
+    }
+
+}
+
+/**
+ * Go through the samples of a 16 bits stereo frame left correlated, first and
+ * second being its two channels, and pack the left and right samples computed
+ * from them.
+ */
+#define PACK_16_DECORRELATED(...) \
+    do { \
+        uint8_t* buffer = data_output->buffer + data_output->position; \
+        uint32_t offset = data_output->is_signed ? 0 : 0x8000; \
+        uint8_t is_little_endian = data_output->is_little_endian; \
+        const int32_t* first = samples; \
+        const int32_t* second = samples + stride; \
+        const int32_t* last_first = first + nb_samples; \
+        (void)nb_channels; \
+        (void)bits_per_sample; \
+        for(; first < last_first; ++first, ++second, buffer += 4) { \
+            int32_t left = 0; \
+            int32_t right = 0; \
+            __VA_ARGS__ \
+            store_16_bits(buffer, (uint32_t)left ^ offset, is_little_endian); \
+            store_16_bits(buffer + 2, (uint32_t)right ^ offset, is_little_endian); \
+        } \
+        data_output->position = buffer - data_output->buffer; \
+    } while(0)
+
+/**
+ * The fused kernels decorrelate a 16 bits stereo frame the way the stereo
+ * kernels do while packing it, saving a pass over the samples.
+ */
+static void pack_16_left_side(data_output_t* data_output, const int32_t* samples, uint32_t stride, uint8_t nb_channels, uint8_t bits_per_sample, uint16_t nb_samples) {
+
+    PACK_16_DECORRELATED(
+        left = *first;
+        right = *first - *second;
+    );
+
+}
+
+
+static void pack_16_right_side(data_output_t* data_output, const int32_t* samples, uint32_t stride, uint8_t nb_channels, uint8_t bits_per_sample, uint16_t nb_samples) {
+
+    PACK_16_DECORRELATED(
+        left = *first + *second;
+        right = *second;
+    );
+
+}
+
+
+static void pack_16_mid_side(data_output_t* data_output, const int32_t* samples, uint32_t stride, uint8_t nb_channels, uint8_t bits_per_sample, uint16_t nb_samples) {
+
+    PACK_16_DECORRELATED(
+        int32_t mid = (int32_t)((uint32_t)*first << 1) | (*second & 0x01);
+
+        left = (mid + *second) >> 1;
+        right = (mid - *second) >> 1;
+    );
+
+}
+
+#undef PACK_16_DECORRELATED
+#endif
+
+#ifdef PACK_X86_KERNELS
+
+/**
+ * Load eight consecutive samples of a channel.
+ */
+__attribute__((target("avx2")))
+static inline __m256i load_eight_samples(const int32_t* samples) {
+
+    return _mm256_loadu_si256((const __m256i*)samples);
+
+}
+
+
+/**
+ * Load the next sixteen samples in output order as 32 bits lanes, that is
+ * sixteen samples of a mono stream or eight samples of each channel of a
+ * stereo one.
+ */
+__attribute__((target("avx2")))
+static inline void load_sixteen_samples(const int32_t* samples, uint32_t stride, uint8_t nb_channels, __m256i* first, __m256i* second) {
+
+    if(nb_channels == 1) {
+        *first = load_eight_samples(samples);
+        *second = load_eight_samples(samples + 8);
+    } else {
+        __m256i left = load_eight_samples(samples);
+        __m256i right = load_eight_samples(samples + stride);
+        __m256i low = _mm256_unpacklo_epi32(left, right);
+        __m256i high = _mm256_unpackhi_epi32(left, right);
+
+        *first = _mm256_permute2x128_si256(low, high, 0x20);
+        *second = _mm256_permute2x128_si256(low, high, 0x31);
+    }
+
+}
+
+
+/**
+ * The vectorised kernels handle mono and stereo streams sixteen samples in
+ * output order at a time and leave the remaining ones to the generic kernel.
+ * Some kernels store a few bytes past the packed ones, which are overwritten
+ * by the next packed ones, so they keep at least sixteen samples for later.
+ */
+#ifdef DECODE_8_BITS
+__attribute__((target("avx2")))
+static void pack_8_avx2(data_output_t* data_output, const int32_t* samples, uint32_t stride, uint8_t nb_channels, uint8_t bits_per_sample, uint16_t nb_samples) {
+
+    uint8_t* buffer = data_output->buffer + data_output->position;
+    uint16_t step = 16 / nb_channels;
+    uint16_t sample_nb = 0;
+    __m128i offset = _mm_set1_epi8(data_output->is_signed ? 0 : (char)0x80);
+
+    for(; (nb_samples - sample_nb) >= step; sample_nb += step, buffer += 16) {
+        __m256i first, second, packed;
+
+        load_sixteen_samples(samples + sample_nb, stride, nb_channels, &first, &second);
+        packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(first, second), _MM_SHUFFLE(3, 1, 2, 0));
+        packed = _mm256_permute4x64_epi64(_mm256_packs_epi16(packed, packed), _MM_SHUFFLE(3, 1, 2, 0));
+        _mm_storeu_si128((__m128i*)buffer, _mm_xor_si128(_mm256_castsi256_si128(packed), offset));
+    }
+
+    data_output->position = buffer - data_output->buffer;
+    pack_generic(data_output, samples + sample_nb, stride, nb_channels, bits_per_sample, nb_samples - sample_nb);
+
+}
+#endif
+
+
+#ifdef DECODE_12_BITS
+/**
+ * Two consecutive samples, in the low and high halves of a 64 bits lane, make
+ * up three bytes. The shifts are the ones of the generic kernel.
+ */
+__attribute__((target("avx2")))
+static void pack_12_avx2(data_output_t* data_output, const int32_t* samples, uint32_t stride, uint8_t nb_channels, uint8_t bits_per_sample, uint16_t nb_samples) {
+
+    uint8_t* buffer = NULL;
+    uint16_t step = 16 / nb_channels;
+    uint16_t sample_nb = 0;
+    __m256i offset = _mm256_set1_epi32(data_output->is_signed ? 0 : 0x800);
+    __m256i mask = _mm256_set1_epi64x(0xFFF);
+    __m256i compact;
+
+    /* A mono stream might be in the middle of a byte. */
+    if(data_output->shift != 0) {
+        pack_generic(data_output, samples, stride, nb_channels, bits_per_sample, 1);
+        sample_nb = 1;
+    }
+
+    if(data_output->is_little_endian)
+        compact = _mm256_setr_epi8(0, 1, 2, 8, 9, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 1, 2, 8, 9, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    else
+        compact = _mm256_setr_epi8(2, 1, 0, 10, 9, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 1, 0, 10, 9, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+
+    buffer = data_output->buffer + data_output->position;
+
+    for(; (nb_samples - sample_nb) >= (2 * step); sample_nb += step, buffer += 24) {
+        __m256i values[2];
+        uint8_t i = 0;
+
+        load_sixteen_samples(samples + sample_nb, stride, nb_channels, values, values + 1);
+
+        for(; i < 2; ++i) {
+            __m256i value = _mm256_xor_si256(values[i], offset);
+            __m256i first = _mm256_and_si256(value, mask);
+            __m256i second = _mm256_and_si256(_mm256_srli_epi64(value, 32), mask);
+            __m256i packed;
+
+            if(data_output->is_little_endian) {
+                packed = _mm256_or_si256(_mm256_and_si256(first, _mm256_set1_epi64x(0xFF)), _mm256_slli_epi64(_mm256_or_si256(_mm256_and_si256(first, _mm256_set1_epi64x(0xF00)), _mm256_and_si256(second, _mm256_set1_epi64x(0xF0))), 4));
+                packed = _mm256_or_si256(packed, _mm256_slli_epi64(_mm256_and_si256(second, _mm256_set1_epi64x(0xF)), 20));
+                packed = _mm256_or_si256(packed, _mm256_slli_epi64(_mm256_and_si256(second, _mm256_set1_epi64x(0xF00)), 8));
+            } else {
+                packed = _mm256_or_si256(_mm256_slli_epi64(first, 12), second);
+            }
+
+            packed = _mm256_shuffle_epi8(packed, compact);
+            _mm_storeu_si128((__m128i*)(buffer + (i * 12)), _mm256_castsi256_si128(packed));
+            _mm_storeu_si128((__m128i*)(buffer + (i * 12) + 6), _mm256_extracti128_si256(packed, 1));
+        }
+    }
+
+    data_output->position = buffer - data_output->buffer;
+    pack_generic(data_output, samples + sample_nb, stride, nb_channels, bits_per_sample, nb_samples - sample_nb);
+
+}
+#endif
+
+
+#ifdef DECODE_16_BITS
+/**
+ * The byte order of 16 bits samples in a vector.
+ */
+__attribute__((target("avx2")))
+static inline __m256i get_16_bits_order(uint8_t is_little_endian) {
+
+    if(is_little_endian)
+        return _mm256_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+
+    return _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14, 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+
+}
+
+
+/**
+ * Store sixteen samples in output order as 16 bits samples.
+ */
+__attribute__((target("avx2")))
+static inline void store_sixteen_16_bits(uint8_t* buffer, __m256i first, __m256i second, __m256i offset, __m256i order) {
+
+    __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(first, second), _MM_SHUFFLE(3, 1, 2, 0));
+
+    _mm256_storeu_si256((__m256i*)buffer, _mm256_shuffle_epi8(_mm256_xor_si256(packed, offset), order));
+
+}
+
+
+/**
+ * Interleave then store eight left and right samples as 16 bits samples.
+ */
+__attribute__((target("avx2")))
+static inline void store_eight_stereo_16_bits(uint8_t* buffer, __m256i left, __m256i right, __m256i offset, __m256i order) {
+
+    __m256i low = _mm256_unpacklo_epi32(left, right);
+    __m256i high = _mm256_unpackhi_epi32(left, right);
+
+    store_sixteen_16_bits(buffer, _mm256_permute2x128_si256(low, high, 0x20), _mm256_permute2x128_si256(low, high, 0x31), offset, order);
+
+}
+
+
+__attribute__((target("avx2")))
+static void pack_16_avx2(data_output_t* data_output, const int32_t* samples, uint32_t stride, uint8_t nb_channels, uint8_t bits_per_sample, uint16_t nb_samples) {
+
+    uint8_t* buffer = data_output->buffer + data_output->position;
+    uint16_t step = 16 / nb_channels;
+    uint16_t sample_nb = 0;
+    __m256i offset = _mm256_set1_epi16(data_output->is_signed ? 0 : (short)0x8000);
+    __m256i order = get_16_bits_order(data_output->is_little_endian);
+
+    for(; (nb_samples - sample_nb) >= step; sample_nb += step, buffer += 32) {
+        __m256i first, second;
+
+        load_sixteen_samples(samples + sample_nb, stride, nb_channels, &first, &second);
+        store_sixteen_16_bits(buffer, first, second, offset, order);
+    }
+
+    data_output->position = buffer - data_output->buffer;
+    pack_generic(data_output, samples + sample_nb, stride, nb_channels, bits_per_sample, nb_samples - sample_nb);
+
+}
+
+
+/**
+ * Go through a 16 bits stereo frame left correlated eight samples of each
+ * channel at a time, first and second being the loaded ones, and pack the
+ * computed left and right samples. The remaining ones are left to the portable
+ * fused kernel.
+ */
+#define PACK_16_DECORRELATED_AVX2(portable_kernel, ...) \
+    do { \
+        uint8_t* buffer = data_output->buffer + data_output->position; \
+        uint16_t sample_nb = 0; \
+        __m256i offset = _mm256_set1_epi16(data_output->is_signed ? 0 : (short)0x8000); \
+        __m256i order = get_16_bits_order(data_output->is_little_endian); \
+        for(; (nb_samples - sample_nb) >= 8; sample_nb += 8, buffer += 32) { \
+            __m256i first = load_eight_samples(samples + sample_nb); \
+            __m256i second = load_eight_samples(samples + stride + sample_nb); \
+            __m256i left, right; \
+            __VA_ARGS__ \
+            store_eight_stereo_16_bits(buffer, left, right, offset, order); \
+        } \
+        data_output->position = buffer - data_output->buffer; \
+        portable_kernel(data_output, samples + sample_nb, stride, nb_channels, bits_per_sample, nb_samples - sample_nb); \
+    } while(0)
+
+__attribute__((target("avx2")))
+static void pack_16_left_side_avx2(data_output_t* data_output, const int32_t* samples, uint32_t stride, uint8_t nb_channels, uint8_t bits_per_sample, uint16_t nb_samples) {
+
+    PACK_16_DECORRELATED_AVX2(pack_16_left_side,
+        left = first;
+        right = _mm256_sub_epi32(first, second);
+    );
+
+}
+
+
+__attribute__((target("avx2")))
+static void pack_16_right_side_avx2(data_output_t* data_output, const int32_t* samples, uint32_t stride, uint8_t nb_channels, uint8_t bits_per_sample, uint16_t nb_samples) {
+
+    PACK_16_DECORRELATED_AVX2(pack_16_right_side,
+        left = _mm256_add_epi32(first, second);
+        right = second;
+    );
+
+}
+
+
+__attribute__((target("avx2")))
+static void pack_16_mid_side_avx2(data_output_t* data_output, const int32_t* samples, uint32_t stride, uint8_t nb_channels, uint8_t bits_per_sample, uint16_t nb_samples) {
+
+    PACK_16_DECORRELATED_AVX2(pack_16_mid_side,
+        __m256i mid = _mm256_or_si256(_mm256_slli_epi32(first, 1), _mm256_and_si256(second, _mm256_set1_epi32(1)));
+
+        left = _mm256_srai_epi32(_mm256_add_epi32(mid, second), 1);
+        right = _mm256_srai_epi32(_mm256_sub_epi32(mid, second), 1);
+    );
+
+}
+
+#undef PACK_16_DECORRELATED_AVX2
+#endif
+
+
+#ifdef DECODE_20_BITS
+/**
+ * Two consecutive samples, in the low and high halves of a 64 bits lane, make
+ * up five bytes. The shifts are the ones of the generic kernel.
+ */
+__attribute__((target("avx2")))
+static void pack_20_avx2(data_output_t* data_output, const int32_t* samples, uint32_t stride, uint8_t nb_channels, uint8_t bits_per_sample, uint16_t nb_samples) {
+
+    uint8_t* buffer = NULL;
+    uint16_t step = 16 / nb_channels;
+    uint16_t sample_nb = 0;
+    __m256i offset = _mm256_set1_epi32(data_output->is_signed ? 0 : 0x80000);
+    __m256i mask = _mm256_set1_epi64x(0xFFFFF);
+    __m256i compact;
+
+    /* A mono stream might be in the middle of a byte. */
+    if(data_output->shift != 0) {
+        pack_generic(data_output, samples, stride, nb_channels, bits_per_sample, 1);
+        sample_nb = 1;
+    }
+
+    if(data_output->is_little_endian)
+        compact = _mm256_setr_epi8(0, 1, 2, 3, 4, 8, 9, 10, 11, 12, -1, -1, -1, -1, -1, -1, 0, 1, 2, 3, 4, 8, 9, 10, 11, 12, -1, -1, -1, -1, -1, -1);
+    else
+        compact = _mm256_setr_epi8(4, 3, 2, 1, 0, 12, 11, 10, 9, 8, -1, -1, -1, -1, -1, -1, 4, 3, 2, 1, 0, 12, 11, 10, 9, 8, -1, -1, -1, -1, -1, -1);
+
+    buffer = data_output->buffer + data_output->position;
+
+    for(; (nb_samples - sample_nb) >= (2 * step); sample_nb += step, buffer += 40) {
+        __m256i values[2];
+        uint8_t i = 0;
+
+        load_sixteen_samples(samples + sample_nb, stride, nb_channels, values, values + 1);
+
+        for(; i < 2; ++i) {
+            __m256i value = _mm256_xor_si256(values[i], offset);
+            __m256i first = _mm256_and_si256(value, mask);
+            __m256i second = _mm256_and_si256(_mm256_srli_epi64(value, 32), mask);
+            __m256i packed;
+
+            if(data_output->is_little_endian) {
+                packed = _mm256_or_si256(_mm256_and_si256(first, _mm256_set1_epi64x(0xFFFF)), _mm256_slli_epi64(_mm256_and_si256(first, _mm256_set1_epi64x(0xF0000)), 4));
+                packed = _mm256_or_si256(packed, _mm256_slli_epi64(_mm256_and_si256(second, _mm256_set1_epi64x(0xF0F0)), 12));
+                packed = _mm256_or_si256(packed, _mm256_slli_epi64(_mm256_and_si256(second, _mm256_set1_epi64x(0xF0F)), 28));
+                packed = _mm256_or_si256(packed, _mm256_slli_epi64(_mm256_and_si256(second, _mm256_set1_epi64x(0xF0000)), 16));
+            } else {
+                packed = _mm256_or_si256(_mm256_slli_epi64(first, 20), second);
+            }
+
+            packed = _mm256_shuffle_epi8(packed, compact);
+            _mm_storeu_si128((__m128i*)(buffer + (i * 20)), _mm256_castsi256_si128(packed));
+            _mm_storeu_si128((__m128i*)(buffer + (i * 20) + 10), _mm256_extracti128_si256(packed, 1));
+        }
+    }
+
+    data_output->position = buffer - data_output->buffer;
+    pack_generic(data_output, samples + sample_nb, stride, nb_channels, bits_per_sample, nb_samples - sample_nb);
+
+}
+#endif
+
+
+#ifdef DECODE_24_BITS
+__attribute__((target("avx2")))
+static void pack_24_avx2(data_output_t* data_output, const int32_t* samples, uint32_t stride, uint8_t nb_channels, uint8_t bits_per_sample, uint16_t nb_samples) {
+
+    uint8_t* buffer = data_output->buffer + data_output->position;
+    uint16_t step = 16 / nb_channels;
+    uint16_t sample_nb = 0;
+    __m256i offset = _mm256_set1_epi32(data_output->is_signed ? 0 : 0x800000);
+    __m256i compact;
+
+    if(data_output->is_little_endian)
+        compact = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1, 0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    else
+        compact = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1, 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+    for(; (nb_samples - sample_nb) >= (2 * step); sample_nb += step, buffer += 48) {
+        __m256i first, second;
+
+        load_sixteen_samples(samples + sample_nb, stride, nb_channels, &first, &second);
+        first = _mm256_shuffle_epi8(_mm256_xor_si256(first, offset), compact);
+        second = _mm256_shuffle_epi8(_mm256_xor_si256(second, offset), compact);
+        _mm_storeu_si128((__m128i*)buffer, _mm256_castsi256_si128(first));
+        _mm_storeu_si128((__m128i*)(buffer + 12), _mm256_extracti128_si256(first, 1));
+        _mm_storeu_si128((__m128i*)(buffer + 24), _mm256_castsi256_si128(second));
+        _mm_storeu_si128((__m128i*)(buffer + 36), _mm256_extracti128_si256(second, 1));
+    }
+
+    data_output->position = buffer - data_output->buffer;
+    pack_generic(data_output, samples + sample_nb, stride, nb_channels, bits_per_sample, nb_samples - sample_nb);
+
+}
+#endif
+
+
+#ifdef DECODE_32_BITS
+__attribute__((target("avx2")))
+static void pack_32_avx2(data_output_t* data_output, const int32_t* samples, uint32_t stride, uint8_t nb_channels, uint8_t bits_per_sample, uint16_t nb_samples) {
+
+    uint8_t* buffer = data_output->buffer + data_output->position;
+    uint16_t step = 16 / nb_channels;
+    uint16_t sample_nb = 0;
+    __m256i offset = _mm256_set1_epi32(data_output->is_signed ? 0 : INT32_MIN);
+    __m256i order;
+
+    if(data_output->is_little_endian)
+        order = _mm256_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    else
+        order = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12, 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+
+    for(; (nb_samples - sample_nb) >= step; sample_nb += step, buffer += 64) {
+        __m256i first, second;
+
+        load_sixteen_samples(samples + sample_nb, stride, nb_channels, &first, &second);
+        _mm256_storeu_si256((__m256i*)buffer, _mm256_shuffle_epi8(_mm256_xor_si256(first, offset), order));
+        _mm256_storeu_si256((__m256i*)(buffer + 32), _mm256_shuffle_epi8(_mm256_xor_si256(second, offset), order));
+    }
+
+    data_output->position = buffer - data_output->buffer;
+    pack_generic(data_output, samples + sample_nb, stride, nb_channels, bits_per_sample, nb_samples - sample_nb);
+
+}
+#endif
+
+#endif
+
+
+/**
+ * Look at what the processor supports (through cpuid) to know which pack
+ * kernels can be used. Should be called once before any call to get_pack_func.
+ */
+void init_pack_kernels(void) {
+
+#ifdef PACK_X86_KERNELS
+    __builtin_cpu_init();
+    g_has_avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+#endif
+
+}
+
+
+/**
+ * Select the fastest kernel packing the samples of a stream into the output
+ * buffer. The endianness and the signedness are taken from the data output
+ * when packing.
+ *
+ * @param bits_per_sample The number of bits per sample of the stream.
+ * @param nb_channels     The number of channels of the stream.
+ *
+ * @return Return the kernel to use for the stream, NULL if the number of bits
+ *         per sample is not supported.
+ */
+pack_func_t get_pack_func(uint8_t bits_per_sample, uint8_t nb_channels) {
+
+#ifdef PACK_X86_KERNELS
+    uint8_t is_vectorised = g_has_avx2 && (nb_channels <= 2);
+#else
+    (void)nb_channels;
+#endif
+
+    switch(bits_per_sample) {
+#ifdef DECODE_8_BITS
+        case 8:
+#ifdef PACK_X86_KERNELS
+            if(is_vectorised)
+                return pack_8_avx2;
+#endif
+            return pack_generic;
+#endif
+#ifdef DECODE_12_BITS
+        case 12:
+#ifdef PACK_X86_KERNELS
+            if(is_vectorised)
+                return pack_12_avx2;
+#endif
+            return pack_generic;
+#endif
+#ifdef DECODE_16_BITS
+        case 16:
+#ifdef PACK_X86_KERNELS
+            if(is_vectorised)
+                return pack_16_avx2;
+#endif
+            return pack_generic;
+#endif
+#ifdef DECODE_20_BITS
+        case 20:
+#ifdef PACK_X86_KERNELS
+            if(is_vectorised)
+                return pack_20_avx2;
+#endif
+            return pack_generic;
+#endif
+#ifdef DECODE_24_BITS
+        case 24:
+#ifdef PACK_X86_KERNELS
+            if(is_vectorised)
+                return pack_24_avx2;
+#endif
+            return pack_generic;
+#endif
+#ifdef DECODE_32_BITS
+        case 32:
+#ifdef PACK_X86_KERNELS
+            if(is_vectorised)
+                return pack_32_avx2;
+#endif
+            return pack_generic;
+#endif
+    }
+
+    return NULL;
+
+}
+
+
+/**
+ * Select the kernel decorrelating a stereo frame while packing it, which is
+ * only available for 16 bits streams.
+ *
+ * @param bits_per_sample     The number of bits per sample of the stream.
+ * @param channel_assignement LEFT_SIDE, RIGHT_SIDE or MID_SIDE.
+ *
+ * @return Return the kernel to use for the frames with this channel
+ *         assignement, NULL if there is none.
+ */
+pack_func_t get_decorrelate_pack_func(uint8_t bits_per_sample, uint8_t channel_assignement) {
+
+#ifdef DECODE_16_BITS
+    if(bits_per_sample != 16)
+        return NULL;
+
+    switch(channel_assignement) {
+        case LEFT_SIDE:
+#ifdef PACK_X86_KERNELS
+            if(g_has_avx2)
+                return pack_16_left_side_avx2;
+#endif
+            return pack_16_left_side;
+
+        case RIGHT_SIDE:
+#ifdef PACK_X86_KERNELS
+            if(g_has_avx2)
+                return pack_16_right_side_avx2;
+#endif
+            return pack_16_right_side;
+
+        case MID_SIDE:
+#ifdef PACK_X86_KERNELS
+            if(g_has_avx2)
+                return pack_16_mid_side_avx2;
+#endif
+            return pack_16_mid_side;
+    }
+#else
+    (void)bits_per_sample;
+    (void)channel_assignement;
+#endif
+
+    return NULL;
+
+}
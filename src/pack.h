@@ -0,0 +1,44 @@
+/**
+ * Copyright © 2013 Jean-François Hren <jfhren@gmail.com>
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+#ifndef PACK_H
+#define PACK_H
+#include <stdint.h>
+#include "decode_flac.h"
+
+/**
+ * Look at what the processor supports (through cpuid) to know which pack
+ * kernels can be used. Should be called once before any call to get_pack_func.
+ */
+void init_pack_kernels(void);
+
+/**
+ * Select the fastest kernel packing the samples of a stream into the output
+ * buffer. The endianness and the signedness are taken from the data output
+ * when packing.
+ *
+ * @param bits_per_sample The number of bits per sample of the stream.
+ * @param nb_channels     The number of channels of the stream.
+ *
+ * @return Return the kernel to use for the stream, NULL if the number of bits
+ *         per sample is not supported.
+ */
+pack_func_t get_pack_func(uint8_t bits_per_sample, uint8_t nb_channels);
+
+/**
+ * Select the kernel decorrelating a stereo frame while packing it, which is
+ * only available for 16 bits streams.
+ *
+ * @param bits_per_sample     The number of bits per sample of the stream.
+ * @param channel_assignement LEFT_SIDE, RIGHT_SIDE or MID_SIDE.
+ *
+ * @return Return the kernel to use for the frames with this channel
+ *         assignement, NULL if there is none.
+ */
+pack_func_t get_decorrelate_pack_func(uint8_t bits_per_sample, uint8_t channel_assignement);
+
+#endif
@@ -0,0 +1,275 @@
+/**
+ * Copyright © 2013 Jean-François Hren <jfhren@gmail.com>
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <sys/types.h>
+
+#include "seek_index.h"
+
+/**
+ * The size in bytes of the seek index header and of a seek point.
+ */
+#define SEEK_INDEX_HEADER_SIZE 32
+#define SEEK_INDEX_POINT_SIZE  16
+
+/**
+ * The magic starting a seek index file.
+ */
+static const uint8_t g_seek_index_magic[4] = {'d', 'f', 'S', 'I'};
+
+
+/**
+ * Put a 32 bits value as big endian bytes.
+ *
+ * @param bytes The bytes are put there.
+ * @param value The value to put.
+ */
+static void put_uint32(uint8_t* bytes, uint32_t value) {
+
+    bytes[0] = value >> 24;
+    bytes[1] = value >> 16;
+    bytes[2] = value >> 8;
+    bytes[3] = value;
+
+}
+
+
+/**
+ * Get a 32 bits value from big endian bytes.
+ *
+ * @param bytes The bytes to get the value from.
+ *
+ * @return Return the value.
+ */
+static uint32_t get_uint32(const uint8_t* bytes) {
+
+    return ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) | ((uint32_t)bytes[2] << 8) | bytes[3];
+
+}
+
+
+/**
+ * Put an offset as 8 big endian bytes.
+ *
+ * @param bytes  The bytes are put there.
+ * @param offset The offset to put.
+ */
+static void put_offset(uint8_t* bytes, off_t offset) {
+
+    /* Shifted twice so that a 32 bits off_t is not shifted by its width. */
+    put_uint32(bytes, (uint32_t)((offset >> 16) >> 16));
+    put_uint32(bytes + 4, (uint32_t)offset);
+
+}
+
+
+/**
+ * Get an offset from 8 big endian bytes.
+ *
+ * @param bytes The bytes to get the offset from.
+ *
+ * @return Return the offset.
+ */
+static off_t get_offset(const uint8_t* bytes) {
+
+    return ((((off_t)get_uint32(bytes)) << 16) << 16) | (off_t)get_uint32(bytes + 4);
+
+}
+
+
+/**
+ * Save the seek points of a frame index into a seek index file.
+ *
+ * @param filename    The name of the seek index file.
+ * @param stream_info The stream info of the indexed stream.
+ * @param frame_index The frame index of the stream.
+ * @param file_size   The size in bytes of the flac file.
+ * @param interval    A seek point is saved every interval frames.
+ *
+ * @return Return 0 if successful, -1 else.
+ */
+int save_seek_index(const char* filename, const stream_info_t* stream_info, const frame_index_t* frame_index, off_t file_size, uint32_t interval) {
+
+    uint8_t header[SEEK_INDEX_HEADER_SIZE];
+    uint32_t nb_points = 0;
+    uint32_t i = 0;
+    FILE* file = NULL;
+
+    if(interval == 0)
+        interval = 1;
+
+    nb_points = (frame_index->nb_entries + interval - 1) / interval;
+
+    memcpy(header, g_seek_index_magic, 4);
+    memcpy(header + 4, stream_info->md5, 16);
+    put_offset(header + 20, file_size);
+    put_uint32(header + 28, nb_points);
+
+    if((file = fopen(filename, "wb")) == NULL) {
+        perror("An error occured while opening the seek index");
+        return -1;
+    }
+
+    if(fwrite(header, SEEK_INDEX_HEADER_SIZE, 1, file) != 1)
+        goto write_error;
+
+    for(i = 0; i < frame_index->nb_entries; i += interval) {
+        uint8_t point[SEEK_INDEX_POINT_SIZE];
+        const frame_index_entry_t* entry = frame_index->entries + i;
+
+#ifndef DISALLOW_64_BITS
+        put_uint32(point, (uint32_t)(entry->first_sample >> 32));
+#else
+        put_uint32(point, 0);
+#endif
+        put_uint32(point + 4, (uint32_t)entry->first_sample);
+        put_offset(point + 8, entry->offset - stream_info->first_frame_offset);
+
+        if(fwrite(point, SEEK_INDEX_POINT_SIZE, 1, file) != 1)
+            goto write_error;
+    }
+
+    if(fclose(file) != 0) {
+        perror("An error occured while writing the seek index");
+        return -1;
+    }
+
+    return 0;
+
+write_error:
+    perror("An error occured while writing the seek index");
+    fclose(file);
+    return -1;
+
+}
+
+
+/**
+ * Warn about an invalid seek index and free what was read of it.
+ *
+ * @param filename    The name of the seek index file.
+ * @param file        The seek index file.
+ * @param points      The read seek points, might be NULL.
+ * @param seek_points The decoded seek points, might be NULL.
+ *
+ * @return Return 0 to tell that no seek point was loaded.
+ */
+static int ignore_seek_index(const char* filename, FILE* file, uint8_t* points, seek_point_t* seek_points) {
+
+    fprintf(stderr, "The seek index %s is invalid, it is ignored\n", filename);
+    free(points);
+    free(seek_points);
+    fclose(file);
+
+    return 0;
+
+}
+
+
+/**
+ * Load the seek points of a seek index file into the stream info in place of
+ * its seek table if the seek index matches the stream.
+ *
+ * @param filename    The name of the seek index file.
+ * @param stream_info The stream info of the stream.
+ * @param file_size   The size in bytes of the flac file.
+ *
+ * @return Return 1 if the seek points were loaded, 0 if there is no seek
+ *         index file, if it does not match the stream or if it is invalid,
+ *         truncated for example, and -1 if an error occured.
+ */
+int load_seek_index(const char* filename, stream_info_t* stream_info, off_t file_size) {
+
+    uint8_t header[SEEK_INDEX_HEADER_SIZE];
+    uint8_t* points = NULL;
+    seek_point_t* seek_points = NULL;
+    uint32_t nb_points = 0;
+    uint32_t nb_seek_points = 0;
+    uint32_t i = 0;
+    long size = 0;
+    FILE* file = NULL;
+
+    if((file = fopen(filename, "rb")) == NULL) {
+        if(errno == ENOENT)
+            return 0;
+
+        perror("An error occured while opening the seek index");
+        return -1;
+    }
+
+    if((fread(header, SEEK_INDEX_HEADER_SIZE, 1, file) != 1) || (memcmp(header, g_seek_index_magic, 4) != 0))
+        return ignore_seek_index(filename, file, NULL, NULL);
+
+    /* A seek index of another file or of an older version of this one. */
+    if((memcmp(header + 4, stream_info->md5, 16) != 0) || (get_offset(header + 20) != file_size)) {
+        fclose(file);
+        return 0;
+    }
+
+    nb_points = get_uint32(header + 28);
+
+    /* The seek points should fill the rest of the file. */
+    if((fseek(file, 0, SEEK_END) == -1) || ((size = ftell(file)) == -1) || (fseek(file, SEEK_INDEX_HEADER_SIZE, SEEK_SET) == -1)) {
+        perror("An error occured while reading the seek index");
+        fclose(file);
+        return -1;
+    }
+
+    if((unsigned long)(size - SEEK_INDEX_HEADER_SIZE) != (unsigned long)nb_points * SEEK_INDEX_POINT_SIZE)
+        return ignore_seek_index(filename, file, NULL, NULL);
+
+    points = (uint8_t*)malloc((size_t)nb_points * SEEK_INDEX_POINT_SIZE + 1);
+    seek_points = (seek_point_t*)malloc(sizeof(seek_point_t) * nb_points + 1);
+    if((points == NULL) || (seek_points == NULL)) {
+        perror("An error occured while allocating the seek index");
+        free(points);
+        free(seek_points);
+        fclose(file);
+        return -1;
+    }
+
+    if(fread(points, SEEK_INDEX_POINT_SIZE, nb_points, file) != nb_points)
+        return ignore_seek_index(filename, file, points, seek_points);
+
+    for(; i < nb_points; ++i) {
+        const uint8_t* point = points + i * SEEK_INDEX_POINT_SIZE;
+
+#ifndef DISALLOW_64_BITS
+        seek_points[nb_seek_points].sample_number = ((uint64_t)get_uint32(point) << 32) | get_uint32(point + 4);
+#else
+        /* Points out of reach on 32 bits. */
+        if(get_uint32(point) != 0)
+            continue;
+
+        seek_points[nb_seek_points].sample_number = get_uint32(point + 4);
+#endif
+        seek_points[nb_seek_points].offset = get_offset(point + 8);
+
+        /* The seek points follow each other inside the flac file. */
+        if((seek_points[nb_seek_points].offset < 0) || ((stream_info->first_frame_offset + seek_points[nb_seek_points].offset) >= file_size))
+            return ignore_seek_index(filename, file, points, seek_points);
+
+        if((nb_seek_points > 0) && ((seek_points[nb_seek_points].sample_number <= seek_points[nb_seek_points - 1].sample_number) || (seek_points[nb_seek_points].offset <= seek_points[nb_seek_points - 1].offset)))
+            return ignore_seek_index(filename, file, points, seek_points);
+
+        ++nb_seek_points;
+    }
+
+    fclose(file);
+    free(points);
+
+    free(stream_info->seek_points);
+    stream_info->seek_points = seek_points;
+    stream_info->nb_seek_points = nb_seek_points;
+
+    return 1;
+
+}
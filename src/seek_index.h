@@ -0,0 +1,61 @@
+/**
+ * Copyright © 2013 Jean-François Hren <jfhren@gmail.com>
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+#ifndef SEEK_INDEX_H
+#define SEEK_INDEX_H
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "decode_flac.h"
+
+/**
+ * A seek index is a file kept next to a flac file holding seek points for it,
+ * for streams without a seek table. It is made of:
+ * - the "dfSI" magic,
+ * - the md5 of the stream info (16 bytes),
+ * - the size in bytes of the flac file (8 bytes),
+ * - the number of seek points (4 bytes),
+ * - for each seek point, its sample number (8 bytes) and the offset of its
+ *   frame from the first frame (8 bytes).
+ * Every number is big endian like in a flac stream. The md5 and the file size
+ * tell if the seek index still matches the flac file.
+ */
+
+/**
+ * The suffix added to the name of a flac file to get the name of its seek
+ * index file.
+ */
+#define SEEK_INDEX_SUFFIX ".idx"
+
+/**
+ * Save the seek points of a frame index into a seek index file.
+ *
+ * @param filename    The name of the seek index file.
+ * @param stream_info The stream info of the indexed stream.
+ * @param frame_index The frame index of the stream.
+ * @param file_size   The size in bytes of the flac file.
+ * @param interval    A seek point is saved every interval frames.
+ *
+ * @return Return 0 if successful, -1 else.
+ */
+int save_seek_index(const char* filename, const stream_info_t* stream_info, const frame_index_t* frame_index, off_t file_size, uint32_t interval);
+
+/**
+ * Load the seek points of a seek index file into the stream info in place of
+ * its seek table if the seek index matches the stream.
+ *
+ * @param filename    The name of the seek index file.
+ * @param stream_info The stream info of the stream.
+ * @param file_size   The size in bytes of the flac file.
+ *
+ * @return Return 1 if the seek points were loaded, 0 if there is no seek
+ *         index file, if it does not match the stream or if it is invalid,
+ *         truncated for example, and -1 if an error occured.
+ */
+int load_seek_index(const char* filename, stream_info_t* stream_info, off_t file_size);
+
+#endif
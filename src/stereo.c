@@ -0,0 +1,278 @@
+/**
+ * Copyright © 2013 Jean-François Hren <jfhren@gmail.com>
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+#include <stdint.h>
+
+#include "stereo.h"
+
+/**
+ * The vectorised kernels are only built for x86 with a compiler supporting
+ * per function target. They can be left out with DISALLOW_SIMD.
+ */
+#if !defined DISALLOW_SIMD && defined __GNUC__ && (defined __x86_64__ || defined __i386__)
+    #define STEREO_X86_KERNELS
+    #include <immintrin.h>
+#endif
+
+#ifdef STEREO_X86_KERNELS
+static uint8_t g_has_sse2 = 0;
+static uint8_t g_has_avx2 = 0;
+#endif
+
+/**
+ * The left channel is the first one and the second one is the difference
+ * between left and right.
+ */
+static void decorrelate_left_side(int32_t* left, int32_t* right, uint16_t nb_samples) {
+
+    int32_t* last_left = left + nb_samples;
+
+    for(; left < last_left; ++left, ++right)
+        *right = *left - *right;
+
+}
+
+
+/**
+ * The first channel is the difference between left and right and the right
+ * channel is the second one.
+ */
+static void decorrelate_right_side(int32_t* left, int32_t* right, uint16_t nb_samples) {
+
+    int32_t* last_left = left + nb_samples;
+
+    for(; left < last_left; ++left, ++right)
+        *left += *right;
+
+}
+
+
+/**
+ * The first channel is the sum of left and right without its least
+ * significant bit, which is the one of the difference, and the second one is
+ * the difference between left and right.
+ */
+static void decorrelate_mid_side(int32_t* left, int32_t* right, uint16_t nb_samples) {
+
+    int32_t* last_left = left + nb_samples;
+
+    for(; left < last_left; ++left, ++right) {
+        int32_t mid = (int32_t)((uint32_t)*left << 1) | (*right & 0x01);
+        int32_t side = *right;
+
+        *left = (mid + side) >> 1;
+        *right = (mid - side) >> 1;
+    }
+
+}
+
+#ifdef STEREO_X86_KERNELS
+
+/**
+ * The number of samples in a SSE2 or AVX2 vector.
+ */
+#define SSE2_NB_LANES ((long)(sizeof(__m128i) / sizeof(int32_t)))
+#define AVX2_NB_LANES ((long)(sizeof(__m256i) / sizeof(int32_t)))
+
+/**
+ * The vectorised kernels handle as many samples as possible a vector at a time
+ * and leave the remaining ones to the portable kernels.
+ */
+__attribute__((target("sse2")))
+static void decorrelate_left_side_sse2(int32_t* left, int32_t* right, uint16_t nb_samples) {
+
+    int32_t* last_left = left + nb_samples;
+
+    for(; (last_left - left) >= SSE2_NB_LANES; left += SSE2_NB_LANES, right += SSE2_NB_LANES)
+        _mm_storeu_si128((__m128i*)right, _mm_sub_epi32(_mm_loadu_si128((const __m128i*)left), _mm_loadu_si128((const __m128i*)right)));
+
+    decorrelate_left_side(left, right, last_left - left);
+
+}
+
+
+__attribute__((target("sse2")))
+static void decorrelate_right_side_sse2(int32_t* left, int32_t* right, uint16_t nb_samples) {
+
+    int32_t* last_left = left + nb_samples;
+
+    for(; (last_left - left) >= SSE2_NB_LANES; left += SSE2_NB_LANES, right += SSE2_NB_LANES)
+        _mm_storeu_si128((__m128i*)left, _mm_add_epi32(_mm_loadu_si128((const __m128i*)left), _mm_loadu_si128((const __m128i*)right)));
+
+    decorrelate_right_side(left, right, last_left - left);
+
+}
+
+
+__attribute__((target("sse2")))
+static void decorrelate_mid_side_sse2(int32_t* left, int32_t* right, uint16_t nb_samples) {
+
+    int32_t* last_left = left + nb_samples;
+    __m128i one = _mm_set1_epi32(1);
+
+    for(; (last_left - left) >= SSE2_NB_LANES; left += SSE2_NB_LANES, right += SSE2_NB_LANES) {
+        __m128i side = _mm_loadu_si128((const __m128i*)right);
+        __m128i mid = _mm_or_si128(_mm_slli_epi32(_mm_loadu_si128((const __m128i*)left), 1), _mm_and_si128(side, one));
+
+        _mm_storeu_si128((__m128i*)left, _mm_srai_epi32(_mm_add_epi32(mid, side), 1));
+        _mm_storeu_si128((__m128i*)right, _mm_srai_epi32(_mm_sub_epi32(mid, side), 1));
+    }
+
+    decorrelate_mid_side(left, right, last_left - left);
+
+}
+
+
+__attribute__((target("avx2")))
+static void decorrelate_left_side_avx2(int32_t* left, int32_t* right, uint16_t nb_samples) {
+
+    int32_t* last_left = left + nb_samples;
+
+    for(; (last_left - left) >= AVX2_NB_LANES; left += AVX2_NB_LANES, right += AVX2_NB_LANES)
+        _mm256_storeu_si256((__m256i*)right, _mm256_sub_epi32(_mm256_loadu_si256((const __m256i*)left), _mm256_loadu_si256((const __m256i*)right)));
+
+    decorrelate_left_side(left, right, last_left - left);
+
+}
+
+
+__attribute__((target("avx2")))
+static void decorrelate_right_side_avx2(int32_t* left, int32_t* right, uint16_t nb_samples) {
+
+    int32_t* last_left = left + nb_samples;
+
+    for(; (last_left - left) >= AVX2_NB_LANES; left += AVX2_NB_LANES, right += AVX2_NB_LANES)
+        _mm256_storeu_si256((__m256i*)left, _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)left), _mm256_loadu_si256((const __m256i*)right)));
+
+    decorrelate_right_side(left, right, last_left - left);
+
+}
+
+
+__attribute__((target("avx2")))
+static void decorrelate_mid_side_avx2(int32_t* left, int32_t* right, uint16_t nb_samples) {
+
+    int32_t* last_left = left + nb_samples;
+    __m256i one = _mm256_set1_epi32(1);
+
+    for(; (last_left - left) >= AVX2_NB_LANES; left += AVX2_NB_LANES, right += AVX2_NB_LANES) {
+        __m256i side = _mm256_loadu_si256((const __m256i*)right);
+        __m256i mid = _mm256_or_si256(_mm256_slli_epi32(_mm256_loadu_si256((const __m256i*)left), 1), _mm256_and_si256(side, one));
+
+        _mm256_storeu_si256((__m256i*)left, _mm256_srai_epi32(_mm256_add_epi32(mid, side), 1));
+        _mm256_storeu_si256((__m256i*)right, _mm256_srai_epi32(_mm256_sub_epi32(mid, side), 1));
+    }
+
+    decorrelate_mid_side(left, right, last_left - left);
+
+}
+
+#undef SSE2_NB_LANES
+#undef AVX2_NB_LANES
+
+#endif
+
+#ifdef DECODE_WIDE_SIDE
+
+/**
+ * Turn the two channels of a 32 bits stereo frame back into left and right
+ * channels when the side channel is kept on 64 bits. The channel which is not
+ * the side one holds the samples it was decoded with and both left and right
+ * end up in the 32 bits channels.
+ *
+ * @param left                The first channel of the frame, left or mid or
+ *                            unused (RIGHT_SIDE.)
+ * @param right               The second channel of the frame, right or unused
+ *                            (LEFT_SIDE and MID_SIDE.)
+ * @param side                The side channel on 64 bits.
+ * @param channel_assignement LEFT_SIDE, RIGHT_SIDE or MID_SIDE.
+ * @param nb_samples          The number of samples of each channel.
+ */
+void decorrelate_wide_side(int32_t* left, int32_t* right, const int64_t* side, uint8_t channel_assignement, uint16_t nb_samples) {
+
+    int32_t* last_left = left + nb_samples;
+
+    switch(channel_assignement) {
+        case LEFT_SIDE:
+            for(; left < last_left; ++left, ++right, ++side)
+                *right = (int32_t)(*left - *side);
+            break;
+
+        case RIGHT_SIDE:
+            for(; left < last_left; ++left, ++right, ++side)
+                *left = (int32_t)(*side + *right);
+            break;
+
+        default:
+            for(; left < last_left; ++left, ++right, ++side) {
+                int64_t mid = (int64_t)((uint64_t)*left << 1) | (*side & 0x01);
+
+                *left = (int32_t)((mid + *side) >> 1);
+                *right = (int32_t)((mid - *side) >> 1);
+            }
+    }
+
+}
+
+#endif
+
+
+/**
+ * Look at what the processor supports (through cpuid) to know which
+ * decorrelation kernels can be used. Should be called once before any call to
+ * get_decorrelate_func.
+ */
+void init_stereo_kernels(void) {
+
+#ifdef STEREO_X86_KERNELS
+    __builtin_cpu_init();
+    g_has_sse2 = __builtin_cpu_supports("sse2") ? 1 : 0;
+    g_has_avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+#endif
+
+}
+
+
+/**
+ * Select the fastest kernel decorrelating a given stereo channel assignement.
+ *
+ * @param channel_assignement LEFT_SIDE, RIGHT_SIDE or MID_SIDE.
+ *
+ * @return Return the kernel to use for decorrelating the frame.
+ */
+decorrelate_func_t get_decorrelate_func(uint8_t channel_assignement) {
+
+    switch(channel_assignement) {
+        case LEFT_SIDE:
+#ifdef STEREO_X86_KERNELS
+            if(g_has_avx2)
+                return decorrelate_left_side_avx2;
+            if(g_has_sse2)
+                return decorrelate_left_side_sse2;
+#endif
+            return decorrelate_left_side;
+
+        case RIGHT_SIDE:
+#ifdef STEREO_X86_KERNELS
+            if(g_has_avx2)
+                return decorrelate_right_side_avx2;
+            if(g_has_sse2)
+                return decorrelate_right_side_sse2;
+#endif
+            return decorrelate_right_side;
+
+        default:
+#ifdef STEREO_X86_KERNELS
+            if(g_has_avx2)
+                return decorrelate_mid_side_avx2;
+            if(g_has_sse2)
+                return decorrelate_mid_side_sse2;
+#endif
+            return decorrelate_mid_side;
+    }
+
+}
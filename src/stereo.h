@@ -0,0 +1,59 @@
+/**
+ * Copyright © 2013 Jean-François Hren <jfhren@gmail.com>
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+#ifndef STEREO_H
+#define STEREO_H
+#include <stdint.h>
+#include "decode_flac.h"
+
+/**
+ * Turn the two channels of a stereo encoded frame back into left and right
+ * channels in place.
+ *
+ * @param left       The first channel of the frame that is left or side
+ *                   (RIGHT_SIDE) or mid (MID_SIDE).
+ * @param right      The second channel of the frame that is side (LEFT_SIDE
+ *                   and MID_SIDE) or right (RIGHT_SIDE).
+ * @param nb_samples The number of samples of each channel.
+ */
+typedef void(*decorrelate_func_t)(int32_t* left, int32_t* right, uint16_t nb_samples);
+
+/**
+ * Look at what the processor supports (through cpuid) to know which
+ * decorrelation kernels can be used. Should be called once before any call to
+ * get_decorrelate_func.
+ */
+void init_stereo_kernels(void);
+
+/**
+ * Select the fastest kernel decorrelating a given stereo channel assignement.
+ *
+ * @param channel_assignement LEFT_SIDE, RIGHT_SIDE or MID_SIDE.
+ *
+ * @return Return the kernel to use for decorrelating the frame.
+ */
+decorrelate_func_t get_decorrelate_func(uint8_t channel_assignement);
+
+#ifdef DECODE_WIDE_SIDE
+/**
+ * Turn the two channels of a 32 bits stereo frame back into left and right
+ * channels when the side channel is kept on 64 bits. The channel which is not
+ * the side one holds the samples it was decoded with and both left and right
+ * end up in the 32 bits channels.
+ *
+ * @param left                The first channel of the frame, left or mid or
+ *                            unused (RIGHT_SIDE.)
+ * @param right               The second channel of the frame, right or unused
+ *                            (LEFT_SIDE and MID_SIDE.)
+ * @param side                The side channel on 64 bits.
+ * @param channel_assignement LEFT_SIDE, RIGHT_SIDE or MID_SIDE.
+ * @param nb_samples          The number of samples of each channel.
+ */
+void decorrelate_wide_side(int32_t* left, int32_t* right, const int64_t* side, uint8_t channel_assignement, uint16_t nb_samples);
+#endif
+
+#endif
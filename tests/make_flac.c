@@ -0,0 +1,213 @@
+/**
+ * Copyright © 2013 Jean-François Hren <jfhren@gmail.com>
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * Write a 16 or 32 bits stereo 44.1 kHz flac stream with a fixed block size
+ * and verbatim subframes, for the tests to damage. The offset of each frame is
+ * printed on the standard output, one per line.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "crc.h"
+#include "md5.h"
+
+#define SAMPLE_RATE 44100
+
+/**
+ * The sample of a channel, a different triangle wave on each channel. The low
+ * bits of 32 bits samples follow the sample number.
+ *
+ * @param channel_nb      The channel of the sample.
+ * @param sample_number   The number of the sample in the stream.
+ * @param bits_per_sample The number of bits of the sample, 16 or 32.
+ *
+ * @return Return the sample.
+ */
+static int32_t get_sample(uint8_t channel_nb, uint32_t sample_number, uint8_t bits_per_sample) {
+
+    uint32_t period = channel_nb ? 331 : 197;
+    int32_t phase = (int32_t)(sample_number % period);
+    int32_t sample = (phase < (int32_t)(period / 2) ? phase : (int32_t)period - phase) * 150 - 12000;
+
+    if(bits_per_sample == 32)
+        return sample * 65536 + (int32_t)(sample_number & 0x7FFF);
+
+    return sample;
+
+}
+
+
+/**
+ * Write the frame holding the samples from first_sample.
+ *
+ * @param output          The stream is written there.
+ * @param frame_number    The number of the frame.
+ * @param first_sample    The number of the first sample of the frame.
+ * @param block_size      The number of samples of the frame.
+ * @param bits_per_sample The number of bits per sample, 16 or 32.
+ * @param md5_context     The samples are hashed there.
+ *
+ * @return Return the size of the frame, 0 if an error occured.
+ */
+static size_t write_frame(FILE* output, uint32_t frame_number, uint32_t first_sample, uint16_t block_size, uint8_t bits_per_sample, md5_context_t* md5_context) {
+
+    uint8_t nb_bytes = bits_per_sample / 8;
+    size_t size = 2 + (size_t)2 * nb_bytes * block_size + 16;
+    uint8_t* frame = (uint8_t*)malloc(size);
+    size_t position = 4;
+    uint16_t crc = 0;
+    uint8_t channel_nb = 0;
+    uint16_t sample_nb = 0;
+    uint8_t byte_nb = 0;
+
+    if(frame == NULL) {
+        perror("An error occured while allocating the frame");
+        return 0;
+    }
+
+    /* Fixed blocking strategy, 16 bits block size at the end of the header,
+       44.1 kHz, independent stereo channels and 16 or 32 bits samples. */
+    frame[0] = 0xFF;
+    frame[1] = 0xF8;
+    frame[2] = 0x79;
+    frame[3] = (bits_per_sample == 32) ? 0x1E : 0x18;
+
+    /* The frame number is coded like an UTF-8 character. */
+    if(frame_number < 0x80) {
+        frame[position++] = frame_number;
+    } else if(frame_number < 0x800) {
+        frame[position++] = 0xC0 | (frame_number >> 6);
+        frame[position++] = 0x80 | (frame_number & 0x3F);
+    } else {
+        frame[position++] = 0xE0 | (frame_number >> 12);
+        frame[position++] = 0x80 | ((frame_number >> 6) & 0x3F);
+        frame[position++] = 0x80 | (frame_number & 0x3F);
+    }
+
+    frame[position++] = (block_size - 1) >> 8;
+    frame[position++] = (block_size - 1) & 0xFF;
+    frame[position] = crc8(frame, position);
+    ++position;
+
+    for(; channel_nb < 2; ++channel_nb) {
+        frame[position++] = 0x02;
+        for(sample_nb = 0; sample_nb < block_size; ++sample_nb) {
+            uint32_t sample = (uint32_t)get_sample(channel_nb, first_sample + sample_nb, bits_per_sample);
+
+            for(byte_nb = nb_bytes; byte_nb > 0; --byte_nb)
+                frame[position++] = (sample >> ((byte_nb - 1) * 8)) & 0xFF;
+        }
+    }
+
+    crc = crc16(0, frame, position);
+    frame[position++] = crc >> 8;
+    frame[position++] = crc & 0xFF;
+
+    for(sample_nb = 0; sample_nb < block_size; ++sample_nb)
+        for(channel_nb = 0; channel_nb < 2; ++channel_nb) {
+            uint32_t sample = (uint32_t)get_sample(channel_nb, first_sample + sample_nb, bits_per_sample);
+            uint8_t bytes[4] = {sample & 0xFF, (sample >> 8) & 0xFF, (sample >> 16) & 0xFF, sample >> 24};
+
+            md5_update(md5_context, bytes, nb_bytes);
+        }
+
+    if(fwrite(frame, 1, position, output) != position) {
+        perror("An error occured while writing the frame");
+        position = 0;
+    }
+
+    free(frame);
+
+    return position;
+
+}
+
+
+int main(int argc, char* argv[]) {
+
+    FILE* output = NULL;
+    uint32_t nb_samples = 0;
+    uint32_t block_size = 0;
+    uint32_t first_sample = 0;
+    uint32_t frame_number = 0;
+    uint8_t bits_per_sample = 16;
+    long offset = 46;
+    uint8_t metadata[46] = {'f', 'L', 'a', 'C', 0x00, 0, 0, 34};
+    md5_context_t md5_context;
+
+    if((argc != 4) && (argc != 5)) {
+        fprintf(stderr, "Usage: %s flac_file nb_samples block_size [bits_per_sample]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    nb_samples = strtoul(argv[2], NULL, 10);
+    block_size = strtoul(argv[3], NULL, 10);
+    if((nb_samples == 0) || (block_size < 16) || (block_size > 65535)) {
+        fprintf(stderr, "There should be samples and the block size should be between 16 and 65535\n");
+        return EXIT_FAILURE;
+    }
+
+    if(argc == 5)
+        bits_per_sample = strtoul(argv[4], NULL, 10);
+
+    if((bits_per_sample != 16) && (bits_per_sample != 32)) {
+        fprintf(stderr, "The bits per sample should be 16 or 32\n");
+        return EXIT_FAILURE;
+    }
+
+    if((output = fopen(argv[1], "wb")) == NULL) {
+        perror("An error occured while opening the flac file");
+        return EXIT_FAILURE;
+    }
+
+    /* The stream info and an empty padding block are written once the md5 is
+       known. */
+    if(fseek(output, sizeof(metadata), SEEK_SET) == -1) {
+        perror("An error occured while writing the flac file");
+        return EXIT_FAILURE;
+    }
+
+    md5_init(&md5_context);
+    for(; first_sample < nb_samples; first_sample += block_size, ++frame_number) {
+        uint16_t frame_block_size = (nb_samples - first_sample) < block_size ? nb_samples - first_sample : block_size;
+        size_t size = write_frame(output, frame_number, first_sample, frame_block_size, bits_per_sample, &md5_context);
+
+        if(size == 0)
+            return EXIT_FAILURE;
+
+        printf("%ld\n", offset);
+        offset += size;
+    }
+
+    metadata[8] = block_size >> 8;
+    metadata[9] = block_size & 0xFF;
+    metadata[10] = block_size >> 8;
+    metadata[11] = block_size & 0xFF;
+    /* The sample rate, the number of channels and the bits per sample minus
+       one and the number of samples. */
+    metadata[18] = SAMPLE_RATE >> 12;
+    metadata[19] = (SAMPLE_RATE >> 4) & 0xFF;
+    metadata[20] = ((SAMPLE_RATE & 0x0F) << 4) | (1 << 1) | ((bits_per_sample - 1) >> 4);
+    metadata[21] = ((bits_per_sample - 1) & 0x0F) << 4;
+    metadata[22] = nb_samples >> 24;
+    metadata[23] = (nb_samples >> 16) & 0xFF;
+    metadata[24] = (nb_samples >> 8) & 0xFF;
+    metadata[25] = nb_samples & 0xFF;
+    md5_final(&md5_context, metadata + 26);
+    metadata[42] = 0x81;
+
+    if((fseek(output, 0, SEEK_SET) == -1) || (fwrite(metadata, 1, sizeof(metadata), output) != sizeof(metadata)) || (fclose(output) == EOF)) {
+        perror("An error occured while writing the flac file");
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+
+}
@@ -0,0 +1,155 @@
+#!/bin/bash
+
+# Decode generated flac streams, some of them damaged, and check the outputs
+# and the exit statuses. The directory of the built binaries is the first
+# argument.
+
+BIN_DIR=${1:-./bin/}
+DECODE="${BIN_DIR}decode_flac_to_pcm"
+TMP_DIR=$(mktemp -d)
+trap 'rm -rf "$TMP_DIR"' EXIT
+
+nb_failures=0
+
+# check description command...: run the command and report a failure if its
+# exit status is not 0.
+check() {
+    local description="$1"
+    shift
+    if "$@"; then
+        echo "ok: $description"
+    else
+        echo "FAILED: $description"
+        nb_failures=$((nb_failures + 1))
+    fi
+}
+
+# make_stream name nb_samples block_size [bits_per_sample]: generate a stream
+# and keep its frame offsets in name.offsets.
+make_stream() {
+    "${BIN_DIR}make_flac" "$TMP_DIR/$1.flac" "${@:2}" > "$TMP_DIR/$1.offsets"
+}
+
+# frame_offset name frame_nb: the offset of a frame of a generated stream.
+frame_offset() {
+    sed -n "$(($2 + 1))p" "$TMP_DIR/$1.offsets"
+}
+
+# insert_bytes input output offset bytes: copy input to output with bytes
+# inserted at offset.
+insert_bytes() {
+    head -c "$3" "$1" > "$2"
+    printf "$4" >> "$2"
+    tail -c +$(($3 + 1)) "$1" >> "$2"
+}
+
+# overwrite_bytes file offset bytes: overwrite the bytes of file at offset.
+overwrite_bytes() {
+    printf "$3" | dd of="$1" bs=1 seek="$2" conv=notrunc 2>/dev/null
+}
+
+# set_index_offset file point_nb offset: set the offset, from the first frame,
+# of a point of a seek index.
+set_index_offset() {
+    local bytes=""
+    local shift
+    for shift in 56 48 40 32 24 16 8 0; do
+        bytes="$bytes$(printf '\\%03o' $((($3 >> shift) & 0xFF)))"
+    done
+    overwrite_bytes "$1" $((32 + $2 * 16 + 8)) "$bytes"
+}
+
+# fails command...: succeed if the command fails.
+fails() {
+    ! "$@"
+}
+
+make_stream stream 200000 4096 || exit 1
+make_stream stream_32 20000 4096 32 || exit 1
+
+
+# The 32 bits sample size of the frame headers is the one of the stream info.
+check "32 bits decoding" "$DECODE" -q --verify-md5 "$TMP_DIR/stream_32.flac" "$TMP_DIR/stream_32.pcm"
+check "32 bits threaded decoding" "$DECODE" -q --verify-md5 --threads 4 "$TMP_DIR/stream_32.flac" "$TMP_DIR/stream_32.pcm"
+
+
+# The threaded decoding reports a damaged frame like the sequential one.
+check "sequential decoding" "$DECODE" -q "$TMP_DIR/stream.flac" "$TMP_DIR/sequential.pcm"
+check "threaded decoding" "$DECODE" -q --threads 4 "$TMP_DIR/stream.flac" "$TMP_DIR/threaded.pcm"
+check "threaded decoding output" cmp -s "$TMP_DIR/sequential.pcm" "$TMP_DIR/threaded.pcm"
+
+insert_bytes "$TMP_DIR/stream.flac" "$TMP_DIR/inserted.flac" $(($(frame_offset stream 20) + 100)) '\001\002\003\004\005\006\007\010'
+check "sequential decoding of a damaged frame fails" fails "$DECODE" -q "$TMP_DIR/inserted.flac" "$TMP_DIR/sequential.pcm" 2>/dev/null
+check "threaded decoding of a damaged frame fails" fails "$DECODE" -q --threads 4 "$TMP_DIR/inserted.flac" "$TMP_DIR/threaded.pcm" 2>/dev/null
+
+
+# An invalid seek index is ignored and the start position is found otherwise.
+check "decoding from a start position" "$DECODE" -q --start 100000 "$TMP_DIR/stream.flac" "$TMP_DIR/start.pcm"
+check "writing the seek index" "$DECODE" -q --write-index "$TMP_DIR/stream.flac"
+head -c 40 "$TMP_DIR/stream.flac.idx" > "$TMP_DIR/truncated.idx"
+mv "$TMP_DIR/truncated.idx" "$TMP_DIR/stream.flac.idx"
+check "decoding from a start position with a truncated seek index" "$DECODE" -q --start 100000 "$TMP_DIR/stream.flac" "$TMP_DIR/truncated.pcm" 2>/dev/null
+check "decoding from a start position with a truncated seek index output" cmp -s "$TMP_DIR/start.pcm" "$TMP_DIR/truncated.pcm"
+
+# A seek point not leading to a frame header is left for a scan of the frames.
+"$DECODE" -q --write-index "$TMP_DIR/stream.flac"
+set_index_offset "$TMP_DIR/stream.flac.idx" 24 $(($(frame_offset stream 24) - $(frame_offset stream 0) + 100))
+check "decoding from a start position with a bogus seek point" "$DECODE" -q --start 100000 "$TMP_DIR/stream.flac" "$TMP_DIR/bogus.pcm" 2>/dev/null
+check "decoding from a start position with a bogus seek point output" cmp -s "$TMP_DIR/start.pcm" "$TMP_DIR/bogus.pcm"
+"$DECODE" -q --write-index --index-interval 2 "$TMP_DIR/stream.flac"
+set_index_offset "$TMP_DIR/stream.flac.idx" 12 $(($(frame_offset stream 23) - $(frame_offset stream 0)))
+check "decoding from a start position with a seek point leading to another frame" "$DECODE" -q --start 100000 "$TMP_DIR/stream.flac" "$TMP_DIR/stale.pcm" 2>/dev/null
+check "decoding from a start position with a seek point leading to another frame output" cmp -s "$TMP_DIR/start.pcm" "$TMP_DIR/stale.pcm"
+rm "$TMP_DIR/stream.flac.idx"
+
+
+# The samples skipped on a damaged frame are counted and concealed, the short
+# last frame of the stream following it or not. Its 200000 samples of 16 bits
+# stereo take 800000 bytes.
+is_size() {
+    [ "$(stat -c %s "$1")" -eq "$2" ]
+}
+
+for frame_nb in 47 48; do
+    cp "$TMP_DIR/stream.flac" "$TMP_DIR/damaged.flac"
+    overwrite_bytes "$TMP_DIR/damaged.flac" $(($(frame_offset stream $frame_nb) + 100)) '\001\002\003\004'
+    for mode in silence repeat; do
+        check "concealing the damaged frame $frame_nb with $mode" "$DECODE" -q --conceal $mode "$TMP_DIR/damaged.flac" "$TMP_DIR/concealed.pcm" 2>/dev/null
+        check "concealing the damaged frame $frame_nb with $mode output length" is_size "$TMP_DIR/concealed.pcm" 800000
+    done
+done
+
+# Nothing is taken from a rejected frame header, here an 8 bits one with a
+# valid CRC-8 after the truncated last frame.
+head -c $(($(frame_offset stream 48) + 1000)) "$TMP_DIR/stream.flac" > "$TMP_DIR/damaged.flac"
+printf '\377\370\300\022\060\352' >> "$TMP_DIR/damaged.flac"
+head -c 100 /dev/zero >> "$TMP_DIR/damaged.flac"
+for mode in silence repeat; do
+    check "concealing up to a rejected frame header with $mode" "$DECODE" -q --conceal $mode "$TMP_DIR/damaged.flac" "$TMP_DIR/concealed.pcm" 2>/dev/null
+    check "concealing up to a rejected frame header with $mode output length" is_size "$TMP_DIR/concealed.pcm" 800000
+done
+
+cp "$TMP_DIR/stream.flac" "$TMP_DIR/damaged.flac"
+overwrite_bytes "$TMP_DIR/damaged.flac" $(($(frame_offset stream 47) + 100)) '\001\002\003\004'
+check "resynchronising after the damaged frame 47" "$DECODE" -q --resync --crc strict "$TMP_DIR/damaged.flac" "$TMP_DIR/resynchronised.pcm" 2> "$TMP_DIR/resync.log"
+check "resynchronising after the damaged frame 47 skipped samples" grep -q ", 4096 samples skipped" "$TMP_DIR/resync.log"
+check "resynchronising after the damaged frame 47 output length" is_size "$TMP_DIR/resynchronised.pcm" $((800000 - 4096 * 4))
+
+
+# After a seek, the skipped samples are counted from the frame seeked to, here
+# the damaged frame 24 holding the sample 100000.
+cp "$TMP_DIR/stream.flac" "$TMP_DIR/damaged.flac"
+overwrite_bytes "$TMP_DIR/damaged.flac" $(($(frame_offset stream 24) + 100)) '\001\002\003\004'
+check "concealing the damaged frame seeked to" "$DECODE" -q --start 100000 --conceal silence "$TMP_DIR/damaged.flac" "$TMP_DIR/concealed.pcm" 2> "$TMP_DIR/resync.log"
+check "concealing the damaged frame seeked to skipped samples" grep -q ", 4096 samples skipped" "$TMP_DIR/resync.log"
+check "concealing the damaged frame seeked to output length" is_size "$TMP_DIR/concealed.pcm" $(((200000 - 100000) * 4))
+check "resynchronising after the damaged frame seeked to" "$DECODE" -q --start 100000 --resync --crc strict "$TMP_DIR/damaged.flac" "$TMP_DIR/resynchronised.pcm" 2>/dev/null
+check "resynchronising after the damaged frame seeked to output length" is_size "$TMP_DIR/resynchronised.pcm" $(((200000 - 102400) * 4))
+
+
+if [ $nb_failures -ne 0 ]; then
+    echo "$nb_failures test(s) failed"
+    exit 1
+fi
+
+echo "All tests passed"